@@ -9,14 +9,17 @@
 
 #define BIPTR_IS_ZERO(x) (x->size == 0)
 
+typedef unsigned __int128 u128;
+typedef __int128 i128;
+
 static inline int
-bit_length(unsigned long x)
+bit_length(u64 x)
 {
 #if (defined(__clang__) || defined(__GNUC__))
     if (x != 0) {
-        /* __builtin_clzl() is available since GCC 3.4.
+        /* __builtin_clzll() is available since GCC 3.4.
            Undefined behavior for x == 0. */
-        return (int)sizeof(unsigned long) * 8 - __builtin_clzl(x);
+        return (int)sizeof(unsigned long long) * 8 - __builtin_clzll(x);
     } else {
         return 0;
     }
@@ -34,7 +37,27 @@ bit_length(unsigned long x)
 #endif
 }
 
-static const u32 STATIC_BYTES[257] = {
+/* the number of trailing zero bits of x, x should not be zero */
+static inline int
+trailing_zeros(u128 x)
+{
+#if (defined(__clang__) || defined(__GNUC__))
+    if ((u64)x != 0) {
+        return __builtin_ctzll((u64)x);
+    } else {
+        return 64 + __builtin_ctzll((u64)(x >> 64));
+    }
+#else
+    int n = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static const u64 STATIC_BYTES[257] = {
     0,   1,   2,   3,   4,   5,   6,   7,   8,   9,   10,  11,  12,  13,  14,
     15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25,  26,  27,  28,  29,
     30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,  41,  42,  43,  44,
@@ -65,12 +88,130 @@ BYTE_BIGINT(u32 b)
     return (bigint_t) {
         .sign = 0,
         .nan = 0,
-        .size = 1,
         .shared = 1,
-        .digit = (u32*)&STATIC_BYTES[b],
+        .size = 1,
+        .digit = (u64*)&STATIC_BYTES[b],
     };
 }
 
+/* Digit arrays are allocated in size classes of powers of two. A freed array
+ * is kept in the free list of its class and reused by the next allocation of
+ * the class, so the short-lived temporaries of arithmetic rarely reach malloc.
+ * Every array has a header digit in front that records its class. Arrays
+ * larger than the largest class are not pooled.
+ */
+#define DIGIT_POOL_CLASS_COUNT 12
+#define DIGIT_POOL_UNPOOLED DIGIT_POOL_CLASS_COUNT
+#ifndef MEMCHECK_H
+#define DIGIT_POOL_MAX_FREE 64
+#else
+/* every array is a malloc so that memcheck can track each of them */
+#define DIGIT_POOL_MAX_FREE 0
+#endif
+
+typedef struct digit_block {
+    struct digit_block* next;
+} digit_block_t;
+
+static digit_block_t* digit_pool[DIGIT_POOL_CLASS_COUNT];
+static int digit_pool_free_count[DIGIT_POOL_CLASS_COUNT];
+
+/* allocate an uninitialized array of at least size digits */
+static inline u64*
+digits_alloc(u32 size)
+{
+    u32 class = bit_length(size - 1);
+    u64* block;
+    if (class < DIGIT_POOL_CLASS_COUNT && digit_pool[class] != NULL) {
+        block = (u64*)digit_pool[class];
+        digit_pool[class] = digit_pool[class]->next;
+        digit_pool_free_count[class]--;
+    } else if (class < DIGIT_POOL_CLASS_COUNT) {
+        /* the header is enough to hold the list link */
+        block = malloc(((1 << class) + 1) * sizeof(u64));
+    } else {
+        class = DIGIT_POOL_UNPOOLED;
+        block = malloc((size + 1) * sizeof(u64));
+    }
+    assert(block != NULL);
+    block[0] = class;
+    return block + 1;
+}
+
+/* the number of digits the array can hold, zero if unknown */
+static inline u32
+digits_capacity(const u64* digit)
+{
+    return digit[-1] == DIGIT_POOL_UNPOOLED ? 0 : (u32)1 << digit[-1];
+}
+
+static inline void
+digits_free(u64* digit)
+{
+    u64* block;
+    u32 class;
+    if (digit == NULL) {
+        return;
+    }
+    block = digit - 1;
+    class = block[0];
+    if (class == DIGIT_POOL_UNPOOLED
+        || digit_pool_free_count[class] >= DIGIT_POOL_MAX_FREE) {
+        free(block);
+        return;
+    }
+    ((digit_block_t*)block)->next = digit_pool[class];
+    digit_pool[class] = (digit_block_t*)block;
+    digit_pool_free_count[class]++;
+}
+
+/* The scratch arena holds the digit arrays that live only during one call.
+ * They are pushed and popped in stack order. A chunk is added when the top
+ * one is full and is freed when everything in it is popped.
+ */
+typedef struct scratch_chunk {
+    struct scratch_chunk* prev;
+    u32 size;
+    u32 cap;
+    u64 data[];
+} scratch_chunk_t;
+
+#define SCRATCH_CHUNK_CAP 4096
+
+static scratch_chunk_t* scratch_top = NULL;
+
+/* push an uninitialized array of size digits, size should not be zero */
+static u64*
+bi_scratch_push(u32 size)
+{
+    u64* p;
+    if (scratch_top == NULL || scratch_top->cap - scratch_top->size < size) {
+        u32 cap = size > SCRATCH_CHUNK_CAP ? size : SCRATCH_CHUNK_CAP;
+        scratch_chunk_t* chunk
+            = malloc(sizeof(scratch_chunk_t) + cap * sizeof(u64));
+        assert(chunk != NULL);
+        chunk->prev = scratch_top;
+        chunk->size = 0;
+        chunk->cap = cap;
+        scratch_top = chunk;
+    }
+    p = scratch_top->data + scratch_top->size;
+    scratch_top->size += size;
+    return p;
+}
+
+/* pop the array and every array pushed after it */
+static void
+bi_scratch_pop(u64* p)
+{
+    while (p < scratch_top->data || p >= scratch_top->data + scratch_top->cap) {
+        scratch_chunk_t* prev = scratch_top->prev;
+        free(scratch_top);
+        scratch_top = prev;
+    }
+    scratch_top->size = p - scratch_top->data;
+}
+
 inline void
 bi_new(bigint_t* x, u32 size)
 {
@@ -82,9 +223,8 @@ bi_new(bigint_t* x, u32 size)
     x->size = size;
     x->sign = 0;
     if (size != 0) {
-        x->digit = (u32*)calloc(size, sizeof(u32));
-        assert(x->digit != NULL);
-        memset(x->digit, 0, size * sizeof(u32));
+        x->digit = digits_alloc(size);
+        memset(x->digit, 0, size * sizeof(u64));
     } else {
         x->digit = NULL;
     }
@@ -112,16 +252,15 @@ bi_copy(bigint_t* dst, const bigint_t* src)
         return;
     }
     *dst = *src;
-    dst->digit = malloc(src->size * sizeof(u32));
-    assert(dst->digit != NULL);
-    memcpy(dst->digit, src->digit, src->size * sizeof(u32));
+    dst->digit = digits_alloc(src->size);
+    memcpy(dst->digit, src->digit, src->size * sizeof(u64));
 }
 
 inline void
 bi_free(bigint_t* x)
 {
-    if (!x->shared && x->digit != NULL) {
-        free(x->digit);
+    if (!x->shared) {
+        digits_free(x->digit);
     }
     x->digit = NULL;
     x->shared = x->nan = x->size = x->sign = 0;
@@ -144,7 +283,7 @@ bi_normalize(bigint_t* x)
     }
     /* use byte number if possible */
     else if (i == 0 && x->sign == 0 && x->digit[0] <= BYTE_BIGINT_MAX) {
-        u32 tmp = x->digit[0];
+        u64 tmp = x->digit[0];
         bi_free(x);
         *x = BYTE_BIGINT(tmp);
     } else {
@@ -159,41 +298,46 @@ bi_extend(bigint_t* x, u32 added_size)
         return;
     }
     if (x->shared) {
-        u32 tmp = x->digit[0];
-        x->digit = (u32*)malloc(sizeof(u32));
-        assert(x->digit != NULL);
+        u64 tmp = x->digit[0];
+        x->digit = digits_alloc(1);
         x->digit[0] = tmp;
         x->shared = 0;
     }
     u32 new_size = x->size + added_size;
-    u32* tmp_mem = calloc(new_size, sizeof(u32));
-    assert(tmp_mem != NULL);
+    /* extend in place if the array has room */
+    if (x->digit != NULL && digits_capacity(x->digit) >= new_size) {
+        memset(x->digit + x->size, 0, added_size * sizeof(u64));
+        x->size = new_size;
+        return;
+    }
+    u64* tmp_mem = digits_alloc(new_size);
+    memset(tmp_mem, 0, new_size * sizeof(u64));
     if (x->digit) {
-        memcpy(tmp_mem, x->digit, x->size * sizeof(u32));
-        free(x->digit);
+        memcpy(tmp_mem, x->digit, x->size * sizeof(u64));
+        digits_free(x->digit);
     }
     x->digit = tmp_mem;
     x->size = new_size;
 }
 
-/* bigint shift left n bits for 1 <= n <= BASE_SHIFT */
+/* bigint shift left n bits for 1 <= n < BASE_SHIFT */
 static inline void
 bi_shl(bigint_t* x, u32 n)
 {
-    if (BIPTR_IS_ZERO(x) || n == 0 || n > BASE_SHIFT) {
+    if (BIPTR_IS_ZERO(x) || n == 0 || n >= BASE_SHIFT) {
         return;
     }
-    u32 i, new_digit, carry = 0;
+    u32 i;
+    u64 new_digit, carry = 0;
     u8 is_shared = x->shared;
     if (x->shared) {
-        u32 tmp = x->digit[0];
-        x->digit = (u32*)malloc(sizeof(u32));
-        assert(x->digit != NULL);
+        u64 tmp = x->digit[0];
+        x->digit = digits_alloc(1);
         x->digit[0] = tmp;
         x->shared = 0;
     }
     for (i = 0; i < x->size; i++) {
-        new_digit = ((x->digit[i] << n) & DIGIT_MASK) + carry;
+        new_digit = (x->digit[i] << n) | carry;
         carry = x->digit[i] >> (BASE_SHIFT - n);
         x->digit[i] = new_digit;
     }
@@ -202,42 +346,18 @@ bi_shl(bigint_t* x, u32 n)
         x->digit[x->size - 1] = carry;
     }
     if (is_shared && x->size == 1 && x->digit[0] <= BYTE_BIGINT_MAX) {
-        u32 tmp = x->digit[0];
+        u64 tmp = x->digit[0];
         bi_free(x);
         *x = BYTE_BIGINT(tmp);
     }
 }
 
-/* bigint shift right n bits for 1 <= n <= BASE_SHIFT */
-static inline void
-bi_shr(bigint_t* x, u32 n)
-{
-    if (BIPTR_IS_ZERO(x) || n == 0 || n > BASE_SHIFT) {
-        return;
-    }
-    if (x->shared) {
-        u32 tmp = x->digit[0];
-        x->digit = (u32*)malloc(sizeof(u32));
-        assert(x->digit != NULL);
-        x->digit[0] = tmp;
-        x->shared = 0;
-    }
-    int i;
-    u32 new_digit, carry = 0;
-    for (i = x->size - 1; i >= 0; i--) {
-        new_digit = (carry & DIGIT_MASK) + (x->digit[i] >> n);
-        carry = x->digit[i] << (BASE_SHIFT - n);
-        x->digit[i] = new_digit;
-    }
-    bi_normalize(x);
-}
-
 inline int
 bi_eq(const bigint_t* a, const bigint_t* b)
 {
     if (a->nan || b->nan || a->digit == NULL || b->digit == NULL
         || a->size != b->size || a->sign != b->sign
-        || memcmp(a->digit, b->digit, a->size * sizeof(u32))) {
+        || memcmp(a->digit, b->digit, a->size * sizeof(u64))) {
         return 0;
     }
     return 1;
@@ -246,46 +366,37 @@ bi_eq(const bigint_t* a, const bigint_t* b)
 inline int
 bi_lt(const bigint_t* a, const bigint_t* b)
 {
-    if (a->sign == b->sign) {
-        if (a->sign == 0) {
-            if (a->size < b->size) {
-                return 1;
-            } else if (a->size == b->size) {
-                return a->size == 0
-                    ? 0
-                    : a->digit[a->size - 1] < b->digit[b->size - 1];
-            } else {
-                return 0;
-            }
-        } else {
-            if (a->size > b->size) {
-                return 1;
-            } else if (a->size == b->size) {
-                assert(a->size != 0);
-                return a->digit[a->size - 1] > b->digit[b->size - 1];
-            } else {
-                return 0;
-            }
-        }
-    } else {
+    int i;
+    if (a->sign != b->sign) {
         return a->sign == 1;
     }
+    if (a->size != b->size) {
+        /* more digits is larger when positive and smaller when negative */
+        return (a->size < b->size) != a->sign;
+    }
+    for (i = a->size - 1; i >= 0; i--) {
+        if (a->digit[i] != b->digit[i]) {
+            return (a->digit[i] < b->digit[i]) != a->sign;
+        }
+    }
+    return 0;
 }
 
 void
 bi_uadd(bigint_t* res, const bigint_t* a, const bigint_t* b)
 {
-    u32 i, carry = 0, a_size = a->size, b_size = b->size;
+    u32 i, a_size = a->size, b_size = b->size;
+    u128 carry = 0;
     /* handle one digit */
     if (a->size == 1 && b->size == 1) {
-        u32 carry = a->digit[0] + b->digit[0];
-        if (carry & CARRY_MASK) {
+        u64 sum = a->digit[0] + b->digit[0];
+        if (sum < a->digit[0]) {
             bi_new(res, 2);
-            res->digit[0] = carry & DIGIT_MASK;
+            res->digit[0] = sum;
             res->digit[1] = 1;
         } else {
             bi_new(res, 1);
-            res->digit[0] = carry;
+            res->digit[0] = sum;
         }
         bi_normalize(res);
         return;
@@ -301,23 +412,24 @@ bi_uadd(bigint_t* res, const bigint_t* a, const bigint_t* b)
     }
     bi_new(res, a_size + 1);
     for (i = 0; i < b_size; ++i) {
-        carry += a->digit[i] + b->digit[i];
-        res->digit[i] = carry & DIGIT_MASK;
+        carry += (u128)a->digit[i] + b->digit[i];
+        res->digit[i] = (u64)carry;
         carry >>= BASE_SHIFT;
     }
     for (; i < a_size; ++i) {
         carry += a->digit[i];
-        res->digit[i] = carry & DIGIT_MASK;
+        res->digit[i] = (u64)carry;
         carry >>= BASE_SHIFT;
     }
-    res->digit[i] = carry;
+    res->digit[i] = (u64)carry;
     bi_normalize(res);
 }
 
 void
 bi_usub(bigint_t* res, const bigint_t* a, const bigint_t* b)
 {
-    u32 a_size = a->size, b_size = b->size, sign = 0, borrow;
+    u32 a_size = a->size, b_size = b->size, sign = 0;
+    u128 borrow;
     i64 i;
     /* handle one digit */
     if (a->size == 1 && b->size == 1) {
@@ -348,6 +460,7 @@ bi_usub(bigint_t* res, const bigint_t* a, const bigint_t* b)
         }
         if (i == -1) {
             *res = ZERO_BIGINT;
+            return;
         }
         if (a->digit[i] < b->digit[i]) {
             const bigint_t* tmp = a;
@@ -359,15 +472,16 @@ bi_usub(bigint_t* res, const bigint_t* a, const bigint_t* b)
     }
     bi_new(res, a_size);
     borrow = 0;
+    /* a negative difference wraps around and leaves all high bits set */
     for (i = 0; i < b_size; ++i) {
-        borrow = a->digit[i] - b->digit[i] - borrow;
-        res->digit[i] = borrow & DIGIT_MASK;
-        borrow >>= BASE_SHIFT;
+        borrow = (u128)a->digit[i] - b->digit[i] - borrow;
+        res->digit[i] = (u64)borrow;
+        borrow = (borrow >> BASE_SHIFT) & 1;
     }
     for (; i < a_size; ++i) {
-        borrow = a->digit[i] - borrow;
-        res->digit[i] = borrow & DIGIT_MASK;
-        borrow >>= BASE_SHIFT;
+        borrow = (u128)a->digit[i] - borrow;
+        res->digit[i] = (u64)borrow;
+        borrow = (borrow >> BASE_SHIFT) & 1;
     }
     if (borrow != 0) {
         printf("bi_usub: last borrow is not zero\n");
@@ -379,11 +493,518 @@ bi_usub(bigint_t* res, const bigint_t* a, const bigint_t* b)
     bi_normalize(res);
 }
 
+/* The functions below work on spans of digits and never allocate. The
+ * result span should not overlap the operands unless noted. */
+
+/* r[0:an] = a[0:an] + b[0:bn] for an >= bn and return the carry. r can be
+ * a */
+static u64
+digits_add(u64* r, const u64* a, u32 an, const u64* b, u32 bn)
+{
+    u128 carry = 0;
+    u32 i;
+    for (i = 0; i < bn; i++) {
+        carry += (u128)a[i] + b[i];
+        r[i] = (u64)carry;
+        carry >>= BASE_SHIFT;
+    }
+    for (; i < an; i++) {
+        carry += a[i];
+        r[i] = (u64)carry;
+        carry >>= BASE_SHIFT;
+    }
+    return (u64)carry;
+}
+
+/* r[0:an] = a[0:an] - b[0:bn] for an >= bn and return the borrow. r can be
+ * a */
+static u64
+digits_sub(u64* r, const u64* a, u32 an, const u64* b, u32 bn)
+{
+    u128 borrow = 0;
+    u32 i;
+    for (i = 0; i < bn; i++) {
+        borrow = (u128)a[i] - b[i] - borrow;
+        r[i] = (u64)borrow;
+        borrow = (borrow >> BASE_SHIFT) & 1;
+    }
+    for (; i < an; i++) {
+        borrow = (u128)a[i] - borrow;
+        r[i] = (u64)borrow;
+        borrow = (borrow >> BASE_SHIFT) & 1;
+    }
+    return (u64)borrow;
+}
+
+/* r[0:an+bn] = a[0:an] * b[0:bn] for an >= bn >= 1 by schoolbook */
+static void
+digits_mul_basecase(u64* r, const u64* a, u32 an, const u64* b, u32 bn)
+{
+    u128 carry = 0;
+    u64 bi;
+    u32 i, j;
+    /* the first row initializes r */
+    bi = b[0];
+    for (j = 0; j < an; j++) {
+        carry += (u128)a[j] * bi;
+        r[j] = (u64)carry;
+        carry >>= BASE_SHIFT;
+    }
+    r[an] = (u64)carry;
+    for (i = 1; i < bn; i++) {
+        /* a[j] * bi + r[i + j] + carry never exceeds 2^128 - 1 */
+        carry = 0;
+        bi = b[i];
+        for (j = 0; j < an; j++) {
+            carry += (u128)a[j] * bi + r[i + j];
+            r[i + j] = (u64)carry;
+            carry >>= BASE_SHIFT;
+        }
+        r[i + an] = (u64)carry;
+    }
+}
+
+/* the sizes of the shorter operand from which each algorithm is used. they
+ * can be overridden with -D to time bi_mul of each algorithm alone. on x86-64
+ * with -O3 the ntt is slower than toom-3 at 6144 digits (9.2 ms to 6.7 ms),
+ * about even at 8192 to 14336 and faster from 16384 (19.4 ms to 23.5 ms) */
+#ifndef KARATSUBA_THRESHOLD
+#define KARATSUBA_THRESHOLD 32
+#endif
+#ifndef TOOM3_THRESHOLD
+#define TOOM3_THRESHOLD 256
+#endif
+#ifndef NTT_THRESHOLD
+#define NTT_THRESHOLD 16384
+#endif
+/* the halves of a split are m + 1 digits long, which is not shorter than a
+ * 3-digit operand */
+#if KARATSUBA_THRESHOLD < 4
+#error "KARATSUBA_THRESHOLD must be at least 4"
+#endif
+
+/* the scratch digits that digits_mul needs for an operand of n digits. a
+ * level takes at most 4n + 20 digits, for toom-3, and recurses on at most
+ * (n + 1) / 2 + 1 digits, for karatsuba */
+static u32
+digits_mul_scratch_size(u32 n)
+{
+    u32 size = 0;
+    while (n >= KARATSUBA_THRESHOLD) {
+        size += 4 * n + 20;
+        n = (n + 1) / 2 + 1;
+    }
+    return size;
+}
+
+static void digits_mul(
+    u64* r, const u64* a, u32 an, const u64* b, u32 bn, u64* scratch
+);
+
+/* x = -x in two's complement of n digits */
+static void
+digits_negate(u64* x, u32 n)
+{
+    u32 i = 0;
+    while (i < n && x[i] == 0) {
+        i++;
+    }
+    if (i < n) {
+        x[i] = -x[i];
+        for (i++; i < n; i++) {
+            x[i] = ~x[i];
+        }
+    }
+}
+
+/* x = x / 2 in two's complement of n digits */
+static void
+digits_shr1(u64* x, u32 n)
+{
+    u32 i;
+    for (i = 0; i + 1 < n; i++) {
+        x[i] = (x[i] >> 1) | (x[i + 1] << (BASE_SHIFT - 1));
+    }
+    x[n - 1] = (x[n - 1] >> 1) | (x[n - 1] & ((u64)1 << (BASE_SHIFT - 1)));
+}
+
+/* r[0:n] = x[0:n] >> s for 0 <= s < BASE_SHIFT. r can be x */
+static void
+digits_shr(u64* r, const u64* x, u32 n, u32 s)
+{
+    u32 i;
+    if (s == 0) {
+        memmove(r, x, n * sizeof(u64));
+        return;
+    }
+    for (i = 0; i + 1 < n; i++) {
+        r[i] = (x[i] >> s) | (x[i + 1] << (BASE_SHIFT - s));
+    }
+    r[n - 1] = x[n - 1] >> s;
+}
+
+/* x = x / 3 in two's complement of n digits, x should be a multiple of 3.
+ * each digit is multiplied by the inverse of 3 modulo 2^64 and the borrow
+ * is the high digit of the quotient digit times 3 */
+static void
+digits_divexact_by3(u64* x, u32 n)
+{
+    u64 borrow = 0, s, t, c;
+    u32 i;
+    for (i = 0; i < n; i++) {
+        s = x[i];
+        t = s - borrow;
+        c = s < borrow;
+        x[i] = t * 0xaaaaaaaaaaaaaaabULL;
+        borrow = (u64)(((u128)x[i] * 3) >> BASE_SHIFT) + c;
+    }
+}
+
+/* r[0:an+bn] = a[0:an] * b[0:bn] for (an + 1) / 2 < bn <= an by karatsuba:
+ * with a = a1 * B^m + a0 and b = b1 * B^m + b0, a * b = z2 * B^2m + z1 *
+ * B^m + z0 where z0 = a0 * b0, z2 = a1 * b1 and z1 = (a0 + a1) * (b0 + b1)
+ * - z0 - z2 */
+static void
+digits_mul_karatsuba(
+    u64* r, const u64* a, u32 an, const u64* b, u32 bn, u64* scratch
+)
+{
+    u32 m = (an + 1) / 2, tn;
+    u64 *sa = scratch, *sb = sa + m + 1, *t = sb + m + 1;
+    scratch = t + 2 * m + 2;
+    digits_mul(r, a, m, b, m, scratch);
+    digits_mul(r + 2 * m, a + m, an - m, b + m, bn - m, scratch);
+    sa[m] = digits_add(sa, a, m, a + m, an - m);
+    sb[m] = digits_add(sb, b, m, b + m, bn - m);
+    digits_mul(t, sa, m + 1, sb, m + 1, scratch);
+    digits_sub(t, t, 2 * m + 2, r, 2 * m);
+    digits_sub(t, t, 2 * m + 2, r + 2 * m, an + bn - 2 * m);
+    /* z1 * B^m fits in the product so its leading zeros can be dropped */
+    tn = 2 * m + 2;
+    while (tn > 0 && t[tn - 1] == 0) {
+        tn--;
+    }
+    digits_add(r + m, r + m, an + bn - m, t, tn);
+}
+
+/* evaluate x = x2 * B^2k + x1 * B^k + x0 of n digits at 1, -1 and -2 into
+ * spans of k + 1 digits. the values at -1 and -2 are in two's complement */
+static void
+digits_toom3_eval(u64* v1, u64* vm1, u64* vm2, const u64* x, u32 n, u32 k)
+{
+    v1[k] = digits_add(v1, x, k, x + 2 * k, n - 2 * k);
+    digits_sub(vm1, v1, k + 1, x + k, k);
+    digits_add(v1, v1, k + 1, x + k, k);
+    /* x(-2) = (x(-1) + x2) * 2 - x0 */
+    digits_add(vm2, vm1, k + 1, x + 2 * k, n - 2 * k);
+    digits_add(vm2, vm2, k + 1, vm2, k + 1);
+    digits_sub(vm2, vm2, k + 1, x, k);
+}
+
+/* r[0:2k+2] = x[0:k+1] * y[0:k+1] where x and y are in two's complement.
+ * x and y are turned into their absolute values */
+static void
+digits_toom3_signed_mul(u64* r, u64* x, u64* y, u32 k, u64* scratch)
+{
+    u64 x_neg = x[k] >> (BASE_SHIFT - 1), y_neg = y[k] >> (BASE_SHIFT - 1);
+    if (x_neg) {
+        digits_negate(x, k + 1);
+    }
+    if (y_neg) {
+        digits_negate(y, k + 1);
+    }
+    digits_mul(r, x, k + 1, y, k + 1, scratch);
+    if (x_neg != y_neg) {
+        digits_negate(r, 2 * k + 2);
+    }
+}
+
+/* add x[0:xn] into r[0:rn] after dropping the leading zeros of x */
+static void
+digits_add_trimmed(u64* r, u32 rn, const u64* x, u32 xn)
+{
+    while (xn > 0 && x[xn - 1] == 0) {
+        xn--;
+    }
+    digits_add(r, r, rn, x, xn);
+}
+
+/* r[0:an+bn] = a[0:an] * b[0:bn] for 2 * ceil(an / 3) < bn <= an by toom-3.
+ * a and b are split into three parts of k digits and seen as polynomials of
+ * B^k. the product polynomial is evaluated at 0, 1, -1, -2 and infinity by
+ * five multiplications and interpolated with the sequence of Bodrato */
+static void
+digits_mul_toom3(
+    u64* r, const u64* a, u32 an, const u64* b, u32 bn, u64* scratch
+)
+{
+    u32 k = (an + 2) / 3, w = 2 * k + 2, rn = an + bn - 4 * k;
+    u64 *pa1 = scratch, *pam1 = pa1 + k + 1, *pam2 = pam1 + k + 1;
+    u64 *pb1 = pam2 + k + 1, *pbm1 = pb1 + k + 1, *pbm2 = pbm1 + k + 1;
+    u64 *v1 = pbm2 + k + 1, *vm1 = v1 + w, *vm2 = vm1 + w;
+    u64 *v0 = r, *vinf = r + 4 * k;
+    scratch = vm2 + w;
+
+    digits_toom3_eval(pa1, pam1, pam2, a, an, k);
+    digits_toom3_eval(pb1, pbm1, pbm2, b, bn, k);
+    digits_mul(v0, a, k, b, k, scratch);
+    digits_mul(vinf, a + 2 * k, an - 2 * k, b + 2 * k, bn - 2 * k, scratch);
+    digits_mul(v1, pa1, k + 1, pb1, k + 1, scratch);
+    digits_toom3_signed_mul(vm1, pam1, pbm1, k, scratch);
+    digits_toom3_signed_mul(vm2, pam2, pbm2, k, scratch);
+
+    /* interpolate in two's complement, the results are the coefficients of
+     * B^k, B^2k and B^3k in v1, vm1 and vm2 */
+    digits_sub(vm2, vm2, w, v1, w);
+    digits_divexact_by3(vm2, w);
+    digits_sub(v1, v1, w, vm1, w);
+    digits_shr1(v1, w);
+    digits_sub(vm1, vm1, w, v0, 2 * k);
+    digits_sub(vm2, vm1, w, vm2, w);
+    digits_shr1(vm2, w);
+    digits_add(vm2, vm2, w, vinf, rn);
+    digits_add(vm2, vm2, w, vinf, rn);
+    digits_add(vm1, vm1, w, v1, w);
+    digits_sub(vm1, vm1, w, vinf, rn);
+    digits_sub(v1, v1, w, vm2, w);
+
+    memset(r + 2 * k, 0, 2 * k * sizeof(u64));
+    digits_add_trimmed(r + k, an + bn - k, v1, w);
+    digits_add_trimmed(r + 2 * k, an + bn - 2 * k, vm1, w);
+    digits_add_trimmed(r + 3 * k, an + bn - 3 * k, vm2, w);
+}
+
+/* The products of huge operands are computed by number-theoretic transforms
+ * over three primes of the form c * 2^k + 1 and put together by the chinese
+ * remainder theorem. The operands are cut into 32-bit pieces. A coefficient
+ * of the convolution is less than 2^64 times the number of pieces of the
+ * shorter operand, so it is less than the product of the primes, about
+ * 2^86, as long as the transform is not longer than 2^23. The modular
+ * products use Montgomery reduction with R = 2^32.
+ */
+typedef struct ntt_prime {
+    u32 p;
+    u32 p_neg_inv; /* -p^-1 mod R */
+    u32 r_mod_p;
+    u32 r2_mod_p;
+} ntt_prime_t;
+
+static const ntt_prime_t NTT_PRIMES[3] = {
+    { 998244353, 998244351, 301989884, 932051910 },
+    { 167772161, 167772159, 100663271, 40265974 },
+    { 469762049, 469762047, 67108855, 460175152 },
+};
+
+/* 3 is a primitive root of all three primes */
+#define NTT_ROOT 3
+#define NTT_MAX_LENGTH ((u32)1 << 23)
+#define NTT_P1_INV_MOD_P2 47450712
+#define NTT_P1P2_INV_MOD_P3 115990628
+
+/* the i-th 32-bit piece of the digit span x */
+#define DIGIT_PIECE(x, i) ((u32)((x)[(i) >> 1] >> (((i) & 1) * 32)))
+
+/* the primes are less than 2^30, so x - p for x < 2p is negative exactly
+ * when its top bit is set. these are branchless because the branches of
+ * the butterflies are unpredictable */
+#define NTT_REDUCE(x, p) ((x) + ((u32)((i32)(x) >> 31) & (p)))
+
+/* a * b * R^-1 mod p for a, b < p */
+static inline u32
+mont_mul(u32 a, u32 b, ntt_prime_t pr)
+{
+    u64 t = (u64)a * b;
+    u32 m = (u32)t * pr.p_neg_inv;
+    u32 u = (u32)((t + (u64)m * pr.p) >> 32) - pr.p;
+    return NTT_REDUCE(u, pr.p);
+}
+
+static u32
+ntt_pow(u64 base, u64 exp, u32 p)
+{
+    u64 res = 1;
+    base %= p;
+    while (exp) {
+        if (exp & 1) {
+            res = res * base % p;
+        }
+        base = base * base % p;
+        exp >>= 1;
+    }
+    return res;
+}
+
+/* the twiddles of the stage of half length len are tw[len:2*len], the
+ * powers of a primitive 2 * len-th root of unity in Montgomery form. they
+ * are taken from the powers of the primitive n-th root of unity w */
+static void
+ntt_twiddles(u32* tw, u32 n, u32 w, ntt_prime_t pr)
+{
+    u32 len = n >> 1, j;
+    w = mont_mul(w, pr.r2_mod_p, pr);
+    tw[len] = pr.r_mod_p;
+    for (j = 1; j < len; j++) {
+        tw[len + j] = mont_mul(tw[len + j - 1], w, pr);
+    }
+    for (len >>= 1; len >= 1; len >>= 1) {
+        for (j = 0; j < len; j++) {
+            tw[len + j] = tw[2 * len + 2 * j];
+        }
+    }
+}
+
+/* forward transform by decimation in frequency with the twiddles of a
+ * primitive n-th root of unity. the output is in bit-reversed order, which
+ * the inverse transform takes as input */
+static void
+ntt_forward(u32* x, u32 n, u32* tw, ntt_prime_t pr)
+{
+    u32 len, i, j, u, v, p = pr.p;
+    for (len = n >> 1; len >= 1; len >>= 1) {
+        for (i = 0; i < n; i += 2 * len) {
+            for (j = 0; j < len; j++) {
+                u = x[i + j];
+                v = x[i + j + len];
+                x[i + j] = NTT_REDUCE(u + v - p, p);
+                v = NTT_REDUCE(u - v, p);
+                x[i + j + len] = mont_mul(v, tw[len + j], pr);
+            }
+        }
+    }
+}
+
+/* inverse transform by decimation in time with the twiddles of the inverse
+ * root, without the division by n */
+static void
+ntt_inverse(u32* x, u32 n, u32* tw, ntt_prime_t pr)
+{
+    u32 len, i, j, u, v, p = pr.p;
+    for (len = 1; len < n; len <<= 1) {
+        for (i = 0; i < n; i += 2 * len) {
+            for (j = 0; j < len; j++) {
+                u = x[i + j];
+                v = mont_mul(x[i + j + len], tw[len + j], pr);
+                x[i + j] = NTT_REDUCE(u + v - p, p);
+                x[i + j + len] = NTT_REDUCE(u - v, p);
+            }
+        }
+    }
+}
+
+/* the number whose residues modulo the three primes are x1, x2 and x3 */
+static inline u128
+ntt_crt(u64 x1, u64 x2, u64 x3)
+{
+    const u64 p1 = NTT_PRIMES[0].p, p2 = NTT_PRIMES[1].p,
+              p3 = NTT_PRIMES[2].p;
+    u64 v2, v3;
+    v2 = (x2 + p2 - x1 % p2) % p2 * NTT_P1_INV_MOD_P2 % p2;
+    v3 = (x3 + p3 - (x1 + v2 * p1) % p3) % p3 * NTT_P1P2_INV_MOD_P3 % p3;
+    return x1 + (u128)v2 * p1 + (u128)v3 * p1 * p2;
+}
+
+/* r[0:an+bn] = a[0:an] * b[0:bn] by number-theoretic transforms, the
+ * number of pieces 2 * (an + bn) should not exceed NTT_MAX_LENGTH */
+static void
+digits_mul_ntt(u64* r, const u64* a, u32 an, const u64* b, u32 bn)
+{
+    u32 na = 2 * an, nb = 2 * bn, n = 1, i, t, scale;
+    u32 *res, *fa, *fb, *tw, *itw;
+    u64* mem;
+    u128 carry = 0;
+    ntt_prime_t pr;
+    while (n < na + nb - 1) {
+        n <<= 1;
+    }
+    /* the residues of the three primes, the transform of b and the twiddles
+     * of both directions */
+    mem = bi_scratch_push(n * 3);
+    res = (u32*)mem;
+    fb = res + 3 * n;
+    tw = fb + n;
+    itw = tw + n;
+    for (t = 0; t < 3; t++) {
+        pr = NTT_PRIMES[t];
+        fa = res + t * n;
+        ntt_twiddles(tw, n, ntt_pow(NTT_ROOT, (pr.p - 1) / n, pr.p), pr);
+        ntt_twiddles(
+            itw, n, ntt_pow(NTT_ROOT, pr.p - 1 - (pr.p - 1) / n, pr.p), pr
+        );
+        for (i = 0; i < na; i++) {
+            fa[i] = DIGIT_PIECE(a, i) % pr.p;
+        }
+        memset(fa + na, 0, (n - na) * sizeof(u32));
+        ntt_forward(fa, n, tw, pr);
+        if (a == b && an == bn) {
+            memcpy(fb, fa, n * sizeof(u32));
+        } else {
+            for (i = 0; i < nb; i++) {
+                fb[i] = DIGIT_PIECE(b, i) % pr.p;
+            }
+            memset(fb + nb, 0, (n - nb) * sizeof(u32));
+            ntt_forward(fb, n, tw, pr);
+        }
+        for (i = 0; i < n; i++) {
+            fa[i] = mont_mul(fa[i], fb[i], pr);
+        }
+        ntt_inverse(fa, n, itw, pr);
+        /* the pointwise products left a factor of R^-1 and the inverse
+         * transform left a factor of n, multiply by n^-1 * R^2 to remove
+         * them */
+        scale = (u64)ntt_pow(n, pr.p - 2, pr.p) * pr.r2_mod_p % pr.p;
+        for (i = 0; i < na + nb - 1; i++) {
+            fa[i] = mont_mul(fa[i], scale, pr);
+        }
+    }
+    for (i = 0; i < na + nb; i++) {
+        if (i < na + nb - 1) {
+            carry += ntt_crt(res[i], res[n + i], res[2 * n + i]);
+        }
+        if (i & 1) {
+            r[i >> 1] |= (u64)(u32)carry << 32;
+        } else {
+            r[i >> 1] = (u32)carry;
+        }
+        carry >>= 32;
+    }
+    bi_scratch_pop(mem);
+}
+
+/* r[0:an+bn] = a[0:an] * b[0:bn] for an >= bn >= 1. The algorithm is chosen
+ * by the size of b. The temporaries are taken from the scratch span, which
+ * should have at least digits_mul_scratch_size(an) digits */
+static void
+digits_mul(u64* r, const u64* a, u32 an, const u64* b, u32 bn, u64* scratch)
+{
+    u64* t;
+    u32 i, n;
+    if (bn < KARATSUBA_THRESHOLD) {
+        digits_mul_basecase(r, a, an, b, bn);
+    } else if (bn <= (an + 1) / 2) {
+        /* b is too short to be split, multiply it with each slice of a */
+        t = scratch;
+        digits_mul(r, a, bn, b, bn, scratch + 2 * bn);
+        memset(r + 2 * bn, 0, (an - bn) * sizeof(u64));
+        for (i = bn; i < an; i += bn) {
+            n = an - i < bn ? an - i : bn;
+            digits_mul(t, b, bn, a + i, n, scratch + 2 * bn);
+            digits_add(r + i, r + i, an + bn - i, t, n + bn);
+        }
+    } else if (bn >= NTT_THRESHOLD && 2 * (an + bn) <= NTT_MAX_LENGTH) {
+        digits_mul_ntt(r, a, an, b, bn);
+    } else if (bn >= TOOM3_THRESHOLD && bn > (an + 2) / 3 * 2) {
+        digits_mul_toom3(r, a, an, b, bn, scratch);
+    } else {
+        digits_mul_karatsuba(r, a, an, b, bn, scratch);
+    }
+}
+
 void
 bi_umul(bigint_t* res, const bigint_t* a, const bigint_t* b)
 {
-    u64 i64m, a0, carry = 0;
-    u32 i, a_size = a->size, b_size = b->size;
+    u32 a_size = a->size, b_size = b->size, scratch_size;
+    u64* scratch = NULL;
+    u128 m;
     /* base conditions */
     if (BIPTR_IS_ZERO(a) || BIPTR_IS_ZERO(b)) {
         *res = ZERO_BIGINT;
@@ -398,133 +1019,482 @@ bi_umul(bigint_t* res, const bigint_t* a, const bigint_t* b)
         return;
     }
     if (a_size == 1 && b_size == 1) {
-        i64m = (u64)a->digit[0] * b->digit[0];
+        m = (u128)a->digit[0] * b->digit[0];
         bi_new(res, 2);
-        res->digit[0] = (u32)i64m & DIGIT_MASK;
-        res->digit[1] = (u32)(i64m >> BASE_SHIFT) & DIGIT_MASK;
+        res->digit[0] = (u64)m;
+        res->digit[1] = (u64)(m >> BASE_SHIFT);
         bi_normalize(res);
         return;
     }
-    if (a_size == 1 || b_size == 1) {
-        /* ensure a_size <= b_size */
-        if (a_size > b_size) {
-            const bigint_t* tmp;
-            u32 tmp_size;
-            tmp = a;
-            a = b;
-            b = tmp;
-            tmp_size = a_size;
-            a_size = b_size;
-            b_size = tmp_size;
+    /* ensure a_size >= b_size */
+    if (a_size < b_size) {
+        const bigint_t* tmp = a;
+        a = b;
+        b = tmp;
+        a_size = b_size;
+        b_size = b->size;
+    }
+    bi_new(res, a_size + b_size);
+    if (b_size >= KARATSUBA_THRESHOLD) {
+        scratch_size = digits_mul_scratch_size(a_size);
+        scratch = bi_scratch_push(scratch_size);
+    }
+    digits_mul(res->digit, a->digit, a_size, b->digit, b_size, scratch);
+    if (scratch != NULL) {
+        bi_scratch_pop(scratch);
+    }
+    bi_normalize(res);
+}
+
+/* the sizes of the divisor from which each division algorithm is used. they
+ * can be overridden with -D, the bigint test lowers DIV_NEWTON_THRESHOLD to
+ * reach the newton division. on x86-64 with -O3 dividing 2n by n digits with
+ * newton is slower at 65536 digits (0.84 s to 0.60 s), about even at 131072
+ * and faster at 262144 (3.3 s to 3.6 s) */
+#ifndef DIV_DC_THRESHOLD
+#define DIV_DC_THRESHOLD 48
+#endif
+#ifndef DIV_NEWTON_THRESHOLD
+#define DIV_NEWTON_THRESHOLD 150000
+#endif
+
+/* compare a[0:n] and b[0:n]. return -1, 0 or 1 */
+static int
+digits_cmp(const u64* a, const u64* b, u32 n)
+{
+    while (n > 0) {
+        n--;
+        if (a[n] != b[n]) {
+            return a[n] < b[n] ? -1 : 1;
         }
-        bi_new(res, b_size + 1);
-        a0 = a->digit[0];
+    }
+    return 0;
+}
+
+/*
+Explanation
+    algorithm from Donald Knuth's 'Art of Computer Programming, Volume 2,
+    Section 4.3.1 Algorithm D
+
+    given nonnegative integers _u (m+n digits) and _v (n digits), we form
+    quotent q (m+1 digits) and remainder r = u mod v (n digits)
+
+    this algorithm is long division with fast estimation of each digits. in
+    long division, where dividing _u (m+n) digit by _v (n) is performed as
+    dividing first n+1 digit of _u with n digits of v m times.
+
+    a good estimation of u/v when u has n+1 digits and v has n digits is
+    q' = min(floor((u[n] * b + u[n-1]) / v[n-1]), b-1). we have q' >= q
+    because
+
+      q' * v[n-1] >= u[n] * b + u[n-1]
+      q' * v[n-1] * b^(n-1) >= u
+      q' >= u / (v[n-1] * b^(n-1))
+         >= u / v
+         >= floor(u / v) = q
+
+    q' is good enough because
+
+      q' <= (u[n] * b + u[n-1]) / v[n-1]
+          = (u[n] * b^n + u[n-1]) * b^(n-1) / (v[n-1] * b^(n-1))
+         <= u / (v[n-1] * b^(n-1))
+          < u / (v - b^(n-1))
+
+    and with q > u / v - 1, we have:
+
+      q' - q < u / (v - b^(n-1)) - (u / v - 1)
+             = (uv - (uv - u * b^(n-1))) / (v * (v - b^(n-1))) + 1
+             = u * b^(n-1) / v / (v - b^(n-1)) + 1
+             = u / v * (b^(n-1) / (v - b^(n-1))) + 1
+             = u / v / v[n-1] + 1
+
+      q' - q - 1 < (u / v) / v[n-1] < (q + 1) / v[n-1]
+
+      (q' - q - 1) * v[n-1] < (q + 1) <= b
+
+      q' - q < b / v[n-1] + 1
+
+    . we see that the difference of q' and q is decided by v[n-1]. if we
+    want q' - q < 3, we need b / v[n-1] + 1 < 3, which means v[n-1] > b / 2.
+    this is what the normalization step does.
+
+    to eliminate the case that q' = q + 2, we need the second significant
+    digit of u and v. using:
+
+      r' = (u[n] * b + u[n-1]) - (q' * v[n-1])
+
+    , there is that:
+
+      u - q'v <= u - q' * v[n-1] * b^(n-1) - ... - v[0]
+              <= u - q' * v[n-1] * b^(n-1) - q' * v[n-2] * b^(n-2)
+              <= u - q' * v[n-1] * b^(n-1) - q' * v[n-2] * b^(n-2)
+               < u[n] * b^[n] + u[n-1] * b^(n-1) + (u[n-2] + 1) * b^(n-2)
+                 - q' * v[n-1] * b^(n-1) - q' * v[n-2] * b^(n-2)
+              == (r' * b + (u[n-2] + 1) - q' * v[n2]) * b^(n-2)
+
+    . so when q' * v[n-2] > r' * b + u[n-2], u - q'v < 0, therefore q' > q
+    and we can safely substract q' with 1 to eliminate the q' = q + 2 case.
+*/
+
+/* q[0:un-vn] = u[0:un] / v[0:vn] by the algorithm above and u[0:vn] becomes
+ * the remainder. v should be normalized and u[un-vn:un] should be less than
+ * v */
+static void
+digits_divmod_basecase(u64* q, u64* u, u32 un, const u64* v, u32 vn)
+{
+    u64 *uj, qj, ujn, ujnm1, ujnm2, carry, borrow, lo, diff;
+    u64 vnm1 = v[vn - 1], vnm2 = (vn > 1) ? v[vn - 2] : 0;
+    u128 utop2, qhat, rhat, prod;
+    u32 j = un - vn, k;
+    /* the quotent's digits are found one by one from j = m to 0, by
+     * performing u[j:j+n] / v[0:n-1] (long division) */
+    while (j > 0) {
+        j--;
+        uj = u + j;
+        ujn = uj[vn];
+        ujnm1 = uj[vn - 1];
+        /* if vn is 1, then ujm2 is zero */
+        ujnm2 = (vn > 1) ? uj[vn - 2] : 0;
+
+        /* 3. Estimate qj and rj:
+         * this step guarentee that q[j] <= qj <= q[j] + 1
+         */
+        utop2 = ((u128)ujn << BASE_SHIFT) | ujnm1;
+        qhat = utop2 / vnm1;
+        rhat = utop2 % vnm1;
+        while ((qhat >> BASE_SHIFT) != 0
+               || qhat * vnm2 > ((rhat << BASE_SHIFT) | ujnm2)) {
+            qhat--;
+            rhat += vnm1;
+            if ((rhat >> BASE_SHIFT) != 0) {
+                break;
+            }
+        }
+        qj = (u64)qhat;
+
+        /* 4. Substract u[j:j+n] by qj * v[0:n-1]
+         * because qj could be larger by one, the last borrow is kept to
+         * detect that
+         */
         carry = 0;
-        for (i = 0; i < b_size; i++) {
-            carry += a0 * b->digit[i];
-            res->digit[i] = carry & DIGIT_MASK;
-            carry = carry >> BASE_SHIFT;
+        borrow = 0;
+        for (k = 0; k < vn; k++) {
+            prod = (u128)qj * v[k] + carry;
+            carry = (u64)(prod >> BASE_SHIFT);
+            lo = (u64)prod;
+            diff = uj[k] - lo;
+            lo = uj[k] < lo;
+            uj[k] = diff - borrow;
+            borrow = lo | (diff < borrow);
         }
-        res->digit[i] = carry;
-        bi_normalize(res);
-        return;
+        diff = uj[vn] - carry;
+        lo = uj[vn] < carry;
+        uj[vn] = diff - borrow;
+        borrow = lo | (diff < borrow);
+
+        /* 5. If the result of last step is negative i.e. u[j+n] < 0,
+         * decrease qj by 1 and add v[0:n-1] back to u[j:j+n]
+         */
+        if (borrow) {
+            /* the carry cancels the borrow */
+            uj[vn] += digits_add(uj, uj, vn, v, vn);
+            qj--;
+        }
+
+        /* 6. Store and quotent digit qj into q */
+        q[j] = qj;
     }
+}
 
-    /* karatsuba algorithm */
-    {
-        bigint_t a_high, a_low, b_high, b_low, z0, z1, z2, tmp1, tmp2;
-        u32 split_size;
-        u32* tmp_mem;
-
-        /* init */
-        z0 = z1 = z2 = a_high = a_low = b_high = b_low = ZERO_BIGINT;
-
-        split_size = ((a_size > b_size) ? a_size : b_size) / 2;
-        /* split a and b */
-        if (a_size <= split_size) {
-            bi_copy(&a_low, a);
-            a_high = ZERO_BIGINT;
+static u64 digits_divmod(u64* q, u64* u, u32 un, const u64* v, u32 vn);
+
+/* q[0:n] = u[0:2n] / v[0:n] by the recursion of Burnikel and Ziegler and
+ * u[0:n] becomes the remainder. v should be normalized. the high and the
+ * low half of the quotient are each estimated by dividing with the high
+ * part of v, the estimate is never less than the digits and only a few
+ * units larger, and then corrected with the low part of v. returns the
+ * digit q[n]. the scratch should have at least n +
+ * digits_mul_scratch_size(n) digits */
+static u64
+digits_divmod_n(u64* q, u64* u, const u64* v, u32 n, u64* scratch)
+{
+    u32 lo = n / 2, hi = n - lo;
+    u64 qh, ql, cy, one = 1;
+    if (n < DIV_DC_THRESHOLD) {
+        return digits_divmod(q, u, 2 * n, v, n);
+    }
+    qh = digits_divmod_n(q + lo, u + 2 * lo, v + lo, hi, scratch);
+    digits_mul(scratch, q + lo, hi, v, lo, scratch + n);
+    cy = digits_sub(u + lo, u + lo, n, scratch, n);
+    if (qh) {
+        cy += digits_sub(u + n, u + n, lo, v, lo);
+    }
+    while (cy) {
+        qh -= digits_sub(q + lo, q + lo, hi, &one, 1);
+        cy -= digits_add(u + lo, u + lo, n, v, n);
+    }
+    /* the remainder is less than v * B^lo so the borrow out of the low half
+     * cancels ql */
+    ql = digits_divmod_n(q, u + hi, v + hi, lo, scratch);
+    digits_mul(scratch, v, hi, q, lo, scratch + n);
+    cy = digits_sub(u, u, n, scratch, n);
+    if (ql) {
+        cy += digits_sub(u + lo, u + lo, hi, v, hi);
+    }
+    while (cy) {
+        digits_sub(q, q, lo, &one, 1);
+        cy -= digits_add(u, u, n, v, n);
+    }
+    return qh;
+}
+
+/* q[0:n] = u[0:n+vn] / v[0:vn] for n < vn and u[0:vn] becomes the
+ * remainder. v should be normalized and u[n:n+vn] should be less than v.
+ * like digits_divmod_n, the quotient is estimated by the top n digits of v
+ * and corrected with the rest. the scratch should have at least vn +
+ * digits_mul_scratch_size(vn) digits */
+static void
+digits_divmod_trimmed(
+    u64* q, u64* u, u32 n, const u64* v, u32 vn, u64* scratch
+)
+{
+    u32 m = vn - n;
+    u64 qh, cy, one = 1;
+    qh = digits_divmod(q, u + m, 2 * n, v + m, n);
+    if (m >= n) {
+        digits_mul(scratch, v, m, q, n, scratch + vn);
+    } else {
+        digits_mul(scratch, q, n, v, m, scratch + vn);
+    }
+    cy = digits_sub(u, u, vn, scratch, vn);
+    if (qh) {
+        cy += digits_sub(u + n, u + n, m, v, m);
+    }
+    while (cy) {
+        qh -= digits_sub(q, q, n, &one, 1);
+        cy -= digits_add(u, u, vn, v, vn);
+    }
+}
+
+/* r[0:an+bn+1] = a[0:an] * b[0:bn+1] where the top digit b[bn] is small. a
+ * is added b[bn] times instead of multiplying by one more digit, which could
+ * double the transform length at a power of two size */
+static void
+digits_mul_small_top(
+    u64* r, const u64* a, u32 an, const u64* b, u32 bn, u64* scratch
+)
+{
+    u64 k;
+    if (an >= bn) {
+        digits_mul(r, a, an, b, bn, scratch);
+    } else {
+        digits_mul(r, b, bn, a, an, scratch);
+    }
+    r[an + bn] = 0;
+    for (k = 0; k < b[bn]; k++) {
+        r[an + bn] += digits_add(r + bn, r + bn, an, a, an);
+    }
+}
+
+/* x[0:n+1] = B^2n / v[0:n] off by a few units, v should be normalized. the
+ * reciprocal x0 of the top h digits of v is refined by one newton step x =
+ * x0 + x0 * (B^2n - v * x0) / B^2n, which doubles the correct digits. h is
+ * a bit more than n / 2 so that the error does not grow in the recursion */
+static void
+digits_reciprocal(u64* x, const u64* v, u32 n)
+{
+    u32 h = n / 2 + 2, en;
+    u64 *xh, *e, *t, *scratch, neg;
+    if (n < DIV_NEWTON_THRESHOLD) {
+        t = bi_scratch_push(2 * n + 1);
+        memset(t, 0, 2 * n * sizeof(u64));
+        t[2 * n] = 1;
+        digits_divmod(x, t, 2 * n + 1, v, n);
+        bi_scratch_pop(t);
+        return;
+    }
+    xh = bi_scratch_push(
+        (h + 1) + (n + h + 1) + (n + 2 * h + 1)
+        + digits_mul_scratch_size(n + h + 1)
+    );
+    e = xh + h + 1;
+    t = e + n + h + 1;
+    scratch = t + n + 2 * h + 1;
+    digits_reciprocal(xh, v + n - h, h);
+    /* with x0 = xh * B^(n-h), e = |B^2n - v * x0| / B^(n-h) */
+    digits_mul_small_top(e, v, n, xh, h, scratch);
+    neg = e[n + h] != 0;
+    if (neg) {
+        e[n + h]--;
+    } else {
+        digits_negate(e, n + h);
+    }
+    en = n + h;
+    while (en > 0 && e[en - 1] == 0) {
+        en--;
+    }
+    /* x = x0 +- xh * e / B^2h, the low h - 3 digits of e change it by less
+     * than B^-2 so they are dropped */
+    memset(x, 0, (n - h) * sizeof(u64));
+    memcpy(x + n - h, xh, (h + 1) * sizeof(u64));
+    if (en + 1 > h) {
+        e += h - 3;
+        en -= h - 3;
+        digits_mul_small_top(t, e, en, xh, h, scratch);
+        if (neg) {
+            digits_sub(x, x, n + 1, t + h + 3, en - 2);
         } else {
-            bi_new(&a_low, split_size);
-            memcpy(a_low.digit, a->digit, split_size * sizeof(u32));
-            bi_new(&a_high, a_size - split_size);
-            memcpy(
-                a_high.digit, a->digit + split_size,
-                (a_size - split_size) * sizeof(u32)
-            );
+            digits_add(x, x, n + 1, t + h + 3, en - 2);
         }
-        bi_normalize(&a_low);
-        bi_normalize(&a_high);
-        if (b_size <= split_size) {
-            bi_copy(&b_low, b);
-            b_high = ZERO_BIGINT;
+    }
+    bi_scratch_pop(xh);
+}
+
+/* q[0:n] = u[0:2n] / v[0:n] with the reciprocal x[0:n+1] of v from
+ * digits_reciprocal and u[0:n] becomes the remainder. u[n:2n] should be
+ * less than v. the quotient is estimated by u[n:2n] * x / B^n, which is off
+ * by a few units, and corrected with the remainder. the scratch should have
+ * at least 4n + 2 + digits_mul_scratch_size(n + 1) digits */
+static void
+digits_divmod_newton(
+    u64* q, u64* u, const u64* v, u32 n, const u64* x, u64* scratch
+)
+{
+    u64 *t = scratch, *qe = t + n, *p = t + 2 * n + 1, one = 1;
+    scratch = p + 2 * n + 1;
+    digits_mul_small_top(t, u + n, n, x, n, scratch);
+    digits_mul_small_top(p, v, n, qe, n, scratch);
+    while (p[2 * n] != 0 || digits_cmp(p, u, 2 * n) > 0) {
+        digits_sub(qe, qe, n + 1, &one, 1);
+        digits_sub(p, p, 2 * n + 1, v, n);
+    }
+    /* the remainder is less than v times the error so it fits in n + 1
+     * digits */
+    digits_sub(u, u, 2 * n, p, 2 * n);
+    while (u[n] != 0 || digits_cmp(u, v, n) >= 0) {
+        digits_add(qe, qe, n + 1, &one, 1);
+        digits_sub(u, u, n + 1, v, n);
+    }
+    memcpy(q, qe, n * sizeof(u64));
+}
+
+/* q[0:un-vn] = u[0:un] / v[0:vn] for un >= vn and u[0:vn] becomes the
+ * remainder. v should be normalized. the algorithm is chosen by the sizes
+ * of the quotient and v. returns the digit q[un-vn], which is 0 or 1
+ * because v is normalized */
+static u64
+digits_divmod(u64* q, u64* u, u32 un, const u64* v, u32 vn)
+{
+    u32 qn = un - vn, n, j;
+    u64 qh, *x = NULL, *scratch;
+    qh = digits_cmp(u + qn, v, vn) >= 0;
+    if (qh) {
+        digits_sub(u + qn, u + qn, vn, v, vn);
+    }
+    if (qn < DIV_DC_THRESHOLD || vn < DIV_DC_THRESHOLD) {
+        digits_divmod_basecase(q, u, un, v, vn);
+        return qh;
+    }
+    scratch = bi_scratch_push(4 * vn + 2 + digits_mul_scratch_size(vn + 1));
+    if (vn >= DIV_NEWTON_THRESHOLD && qn >= vn) {
+        x = bi_scratch_push(vn + 1);
+        digits_reciprocal(x, v, vn);
+    }
+    /* like long division with the digits of B^vn, the quotient is found by
+     * blocks of vn digits from the top, the top block takes the rest */
+    n = qn % vn == 0 ? vn : qn % vn;
+    j = qn;
+    while (j > 0) {
+        j -= n;
+        if (n < vn) {
+            digits_divmod_trimmed(q + j, u + j, n, v, vn, scratch);
+        } else if (x != NULL) {
+            digits_divmod_newton(q + j, u + j, v, vn, x, scratch);
         } else {
-            bi_new(&b_low, split_size);
-            memcpy(b_low.digit, b->digit, split_size * sizeof(u32));
-            bi_new(&b_high, b_size - split_size);
-            memcpy(
-                b_high.digit, b->digit + split_size,
-                (b_size - split_size) * sizeof(u32)
-            );
+            digits_divmod_n(q + j, u + j, v, vn, scratch);
         }
-        bi_normalize(&b_low);
-        bi_normalize(&b_high);
-
-        /* z0 */
-        bi_umul(&z0, &a_low, &b_low);
-
-        /* z1' */
-        tmp1 = bi_add(&a_low, &a_high);
-        tmp2 = bi_add(&b_low, &b_high);
-        bi_umul(&z1, &tmp1, &tmp2);
-        bi_free(&tmp1);
-        bi_free(&tmp2);
-        bi_free(&a_low);
-        bi_free(&b_low);
-
-        /* z2' */
-        bi_umul(&z2, &a_high, &b_high);
-        bi_free(&a_high);
-        bi_free(&b_high);
-
-        /* z1 = (z1' - z2' - z0) * b ^ split_size */
-        tmp1 = bi_sub(&z1, &z0);
-        bi_free(&z1);
-        z1 = bi_sub(&tmp1, &z2);
-        bi_free(&tmp1);
-        tmp_mem = calloc(z1.size + split_size, sizeof(u32));
-        assert(tmp_mem != NULL);
-        memcpy(tmp_mem + split_size, z1.digit, z1.size * sizeof(u32));
-        if (z1.shared) {
-            z1.shared = 0;
-        } else {
-            free(z1.digit);
+        n = vn;
+    }
+    bi_scratch_pop(scratch);
+    return qh;
+}
+
+/* (u, v) = (a * u - b * v, d * v - c * u) for the cofactors of a lehmer
+ * step, or the negated results if odd is set. the results are known to be
+ * nonnegative and less than u so they are computed in place in two's
+ * complement of n digits */
+static void
+digits_lehmer_update(
+    u64* u, u64* v, u32 n, u64 a, u64 b, u64 c, u64 d, int odd
+)
+{
+    u128 pa = 0, pb = 0, pc = 0, pd = 0;
+    u64 borrow_u = 0, borrow_v = 0, ui, vi, lo, diff;
+    u32 i;
+    for (i = 0; i < n; i++) {
+        ui = u[i];
+        vi = v[i];
+        pa += (u128)a * ui;
+        pb += (u128)b * vi;
+        pc += (u128)c * ui;
+        pd += (u128)d * vi;
+        diff = (u64)pa - (u64)pb;
+        lo = (u64)pa < (u64)pb;
+        u[i] = diff - borrow_u;
+        borrow_u = lo | (diff < borrow_u);
+        diff = (u64)pd - (u64)pc;
+        lo = (u64)pd < (u64)pc;
+        v[i] = diff - borrow_v;
+        borrow_v = lo | (diff < borrow_v);
+        pa >>= BASE_SHIFT;
+        pb >>= BASE_SHIFT;
+        pc >>= BASE_SHIFT;
+        pd >>= BASE_SHIFT;
+    }
+    if (odd) {
+        digits_negate(u, n);
+        digits_negate(v, n);
+    }
+}
+
+/* q[0:an-dn+1] = a[0:an] / d[0:dn] for a multiple a of an odd d. the
+ * quotient is found from the lowest digit up, each digit is the low digit
+ * of the rest times the inverse of d modulo B, so no estimation is needed.
+ * the digits of a above the quotient are never read, so only the part of
+ * each subtraction below them is done. a is overwritten */
+static void
+digits_divexact(u64* q, u64* a, u32 an, const u64* d, u32 dn)
+{
+    u32 qn = an - dn + 1, i, k, m;
+    u64 inv = d[0], qi, carry, borrow, lo, diff;
+    u128 prod;
+    /* d * d = 1 modulo 8 for an odd d, each newton step doubles the
+     * correct bits from 3 */
+    for (i = 0; i < 5; i++) {
+        inv *= 2 - d[0] * inv;
+    }
+    for (i = 0; i < qn; i++) {
+        qi = a[i] * inv;
+        q[i] = qi;
+        m = dn < qn - i ? dn : qn - i;
+        carry = 0;
+        borrow = 0;
+        for (k = 0; k < m; k++) {
+            prod = (u128)qi * d[k] + carry;
+            carry = (u64)(prod >> BASE_SHIFT);
+            lo = (u64)prod;
+            diff = a[i + k] - lo;
+            lo = a[i + k] < lo;
+            a[i + k] = diff - borrow;
+            borrow = lo | (diff < borrow);
         }
-        z1.digit = tmp_mem;
-        z1.size = z1.size + split_size;
-
-        /* z2 = z2' * b ^ (2 * split_size) */
-        if (z2.size != 0) {
-            split_size *= 2;
-            tmp_mem = calloc(z2.size + split_size, sizeof(u32));
-            assert(tmp_mem != NULL);
-            memcpy(tmp_mem + split_size, z2.digit, z2.size * sizeof(u32));
-            if (z2.shared) {
-                z2.shared = 0;
-            } else {
-                free(z2.digit);
-            }
-            z2.digit = tmp_mem;
-            z2.size = z2.size + split_size;
+        for (k = i + m; k < qn && (carry | borrow); k++) {
+            diff = a[k] - carry;
+            lo = a[k] < carry;
+            a[k] = diff - borrow;
+            borrow = lo | (diff < borrow);
+            carry = 0;
         }
-
-        /* m = z0 + z1 + z2 */
-        tmp1 = bi_add(&z0, &z1);
-        *res = bi_add(&tmp1, &z2);
-        bi_free(&z0);
-        bi_free(&z1);
-        bi_free(&z2);
-        bi_free(&tmp1);
     }
 }
 
@@ -571,187 +1541,59 @@ bi_udivmod(bigint_t* q, bigint_t* r, const bigint_t* _u, const bigint_t* _v)
         bi_new(r, 1);
         v0 = _v->digit[0];
         for (i = _u->size - 1; i >= 0; i--) {
-            u64 t = (r64 << 32) | _u->digit[i];
-            q->digit[i] = t / v0;
-            r64 = t % v0;
+            u128 t = ((u128)r64 << BASE_SHIFT) | _u->digit[i];
+            q->digit[i] = (u64)(t / v0);
+            r64 = (u64)(t % v0);
         }
         r->digit[0] = r64;
         bi_normalize(q);
         bi_normalize(r);
         return;
     }
-    /*
-    Explanation
-        algorithm from Donald Knuth's 'Art of Computer Programming, Volume 2,
-        Section 4.3.1 Algorithm D
-
-        given nonnegative integers _u (m+n digits) and _v (n digits), we form
-        quotent q (m+1 digits) and remainder r = u mod v (n digits)
-
-        this algorithm is long division with fast estimation of each digits. in
-        long division, where dividing _u (m+n) digit by _v (n) is performed as
-        dividing first n+1 digit of _u with n digits of v m times.
-
-        a good estimation of u/v when u has n+1 digits and v has n digits is
-        q' = min(floor((u[n] * b + u[n-1]) / v[n-1]), b-1). we have q' >= q
-        because
-
-          q' * v[n-1] >= u[n] * b + u[n-1]
-          q' * v[n-1] * b^(n-1) >= u
-          q' >= u / (v[n-1] * b^(n-1))
-             >= u / v
-             >= floor(u / v) = q
-
-        q' is good enough because
-
-          q' <= (u[n] * b + u[n-1]) / v[n-1]
-              = (u[n] * b^n + u[n-1]) * b^(n-1) / (v[n-1] * b^(n-1))
-             <= u / (v[n-1] * b^(n-1))
-              < u / (v - b^(n-1))
-
-        and with q > u / v - 1, we have:
-
-          q' - q < u / (v - b^(n-1)) - (u / v - 1)
-                 = (uv - (uv - u * b^(n-1))) / (v * (v - b^(n-1))) + 1
-                 = u * b^(n-1) / v / (v - b^(n-1)) + 1
-                 = u / v * (b^(n-1) / (v - b^(n-1))) + 1
-                 = u / v / v[n-1] + 1
-
-          q' - q - 1 < (u / v) / v[n-1] < (q + 1) / v[n-1]
-
-          (q' - q - 1) * v[n-1] < (q + 1) <= b
-
-          q' - q < b / v[n-1] + 1
-
-        . we see that the difference of q' and q is decided by v[n-1]. if we
-        want q' - q < 3, we need b / v[n-1] + 1 < 3, which means v[n-1] > b / 2.
-        this is what the normalization step does.
-
-        to eliminate the case that q' = q + 2, we need the second significant
-        digit of u and v. using:
-
-          r' = (u[n] * b + u[n-1]) - (q' * v[n-1])
-
-        , there is that:
-
-          u - q'v <= u - q' * v[n-1] * b^(n-1) - ... - v[0]
-                  <= u - q' * v[n-1] * b^(n-1) - q' * v[n-2] * b^(n-2)
-                  <= u - q' * v[n-1] * b^(n-1) - q' * v[n-2] * b^(n-2)
-                   < u[n] * b^[n] + u[n-1] * b^(n-1) + (u[n-2] + 1) * b^(n-2)
-                     - q' * v[n-1] * b^(n-1) - q' * v[n-2] * b^(n-2)
-                  == (r' * b + (u[n-2] + 1) - q' * v[n2]) * b^(n-2)
-
-        . so when q' * v[n-2] > r' * b + u[n-2], u - q'v < 0, therefore q' > q
-        and we can safely substract q' with 1 to eliminate the q' = q + 2 case.
-    */
     {
-        bigint_t u = ZERO_BIGINT, v = ZERO_BIGINT;
-        u32 *uj, *v0;
-        u32 d, j, k, qj, rj, ujn, ujnm1, ujnm2;
-        i32 borrow;
-        u64 utop2, vnm1, vnm2;
-        i64 borrow64;
+        u64 *u, *v, carry;
+        u32 d, i;
 
         /* 1. Normalize:
          * shift u and v so that the top digit of v >= floor (base / 2) and
          * increase the size of u by one */
         d = BASE_SHIFT - bit_length(_v->digit[_v->size - 1]);
-        bi_copy(&u, _u);
-        bi_copy(&v, _v);
-
-        bi_extend(&u, 1);
-        u_size++;
-        if (d != 0) {
-            bi_shl(&u, d);
-            bi_shl(&v, d);
+        /* the shifted copies are temporaries so they live in the scratch */
+        u = bi_scratch_push(u_size + 1);
+        v = bi_scratch_push(v_size);
+        /* shifting a digit by BASE_SHIFT is undefined so d = 0 is special */
+        carry = 0;
+        for (i = 0; i < u_size; i++) {
+            u[i] = (_u->digit[i] << d) | carry;
+            carry = d ? _u->digit[i] >> (BASE_SHIFT - d) : 0;
         }
-        /* printf("u "); bi_print(&u, '\n'); */
-        /* printf("v "); bi_print(&v, '\n'); */
-
-        /* 2. Initialize j:
-         * now u has at most m+n+1 digits and v has n digits, the quotent will
-         * have at most m+1 digits. in the loop, we get quotent's digits one by
-         * one from j = m to 0, by performing u[j:j+n] / v[0:n-1] (long
-         * division)
-         */
-        j = u_size - v_size - 1;
-        bi_new(q, j + 1);
-        v0 = v.digit;
-        vnm1 = (u64)v.digit[v_size - 1];
-        vnm2 = (u64)(v_size > 1) ? v.digit[v_size - 2] : 0;
-        /* for j = m to 0 */
-        for (uj = u.digit + j; uj >= u.digit; uj--, j--) {
-            ujn = uj[v_size];
-            ujnm1 = uj[v_size - 1];
-            /* if v_size is 1, then ujm2 is zero */
-            ujnm2 = (v_size > 1) * uj[v_size - 2];
-            /* printf("ujn %d ujnm1 %d\n", ujn, ujnm1); */
-
-            /* 3. Estimate qj and rj:
-             * this step guarentee that q[j] <= qj <= q[j] + 1
-             */
-            utop2 = (((u64)ujn) << BASE_SHIFT) | (u64)ujnm1;
-            /* printf("utop2 %lld vnm1 %lld\n", utop2, vnm1); */
-            qj = (u32)(utop2 / vnm1);
-            rj = (u32)(utop2 % vnm1);
-            while (qj == DIGIT_BASE
-                   || (u64)qj * vnm2 > ((u64)rj << BASE_SHIFT) + ujnm2) {
-                qj--;
-                rj += vnm1;
-                if (rj < DIGIT_BASE) {
-                    break;
-                }
-            }
-            /* printf("qj rj %lld %lld \n", qj, rj); */
-
-            /* 4. Substract u[j:j+n] by qj * v[0:n-1]
-             * because qj could be larger by one, the borrow need to be signed
-             * to detect that
-             */
-            borrow = 0;
-            borrow64 = 0;
-            for (k = 0; k < v_size; k++) {
-                /* need to use 64 bit because qj * v[k] has 64 bit result */
-                borrow64 = (i64)uj[k] + borrow - (i64)qj * v0[k];
-                uj[k] = (u32)borrow64 & DIGIT_MASK;
-                /* preform arithmetic right shift and cast to 32 bit */
-                borrow = (i32)(borrow64 >> BASE_SHIFT);
-            }
-            uj[v_size] += borrow;
-
-            /* 5. If the result of last step is negative i.e. u[j+n] < 0,
-             * decrease qj by 1 and add v[0:n-1] back to u[j:j+n]
-             */
-            if (((i32)uj[v_size]) < 0) {
-                /* printf("uj[v_size]) < 0\n"); */
-                u32 carry = 0;
-                /* add v[0:n-1] back to u[j:j+n] */
-                for (k = 0; k < v_size; k++) {
-                    carry += uj[k] + v0[k];
-                    uj[k] = carry & DIGIT_MASK;
-                    carry >>= BASE_SHIFT;
-                }
-                qj--;
-            }
-
-            /* 6. Store and quotent digit qj into q */
-            q->digit[j] = qj;
-            /* printf("%d ", j); bi_print(q, '\n'); */
+        u[u_size++] = carry;
+        carry = 0;
+        for (i = 0; i < v_size; i++) {
+            v[i] = (_v->digit[i] << d) | carry;
+            carry = d ? _v->digit[i] >> (BASE_SHIFT - d) : 0;
         }
 
+        /* 2. Divide:
+         * now u has at most m+n+1 digits and its top digit is less than the
+         * top digit of v, so the quotent has at most m+1 digits. the
+         * algorithm is chosen by the sizes in digits_divmod
+         */
+        bi_new(q, u_size - v_size);
+        digits_divmod(q->digit, u, u_size, v, v_size);
+
         /* the content of u (shifted _u) is now shifted remainder, shift it
          * back
          */
-        bi_copy(r, &u);
-        bi_shr(r, d);
+        bi_new(r, v_size);
+        for (i = 0; i < v_size; i++) {
+            r->digit[i] = d ? (u[i] >> d) | (u[i + 1] << (BASE_SHIFT - d))
+                            : u[i];
+        }
         /* normalize the result */
         bi_normalize(r);
         bi_normalize(q);
-        /* free u & v */
-        bi_free(&u);
-        bi_free(&v);
-        /* printf("r "); bi_print(r, '\n'); */
-        /* printf("q "); bi_print(r, '\n'); */
+        bi_scratch_pop(u);
     }
 }
 
@@ -796,7 +1638,7 @@ bi_sub(const bigint_t* a, const bigint_t* b)
         return ZERO_BIGINT;
     } else if (BIPTR_IS_ZERO(a)) {
         bi_copy(&c, b);
-        c.sign = 1;
+        c.sign = !b->sign;
         return c;
     } else if (BIPTR_IS_ZERO(b)) {
         bi_copy(&c, a);
@@ -806,7 +1648,8 @@ bi_sub(const bigint_t* a, const bigint_t* b)
     if (a->sign) {
         if (b->sign) {
             bi_usub(&c, a, b);
-            c.sign = !c.sign;
+            /* zero has no sign */
+            c.sign = !c.sign && !BIPTR_IS_ZERO((&c));
         } else {
             bi_uadd(&c, b, a);
             c.sign = !c.sign;
@@ -821,14 +1664,103 @@ bi_sub(const bigint_t* a, const bigint_t* b)
     return c;
 }
 
+/* compare the absolute values of a and b. return -1, 0 or 1 */
+static inline int
+bi_ucmp(const bigint_t* a, const bigint_t* b)
+{
+    int i;
+    if (a->size != b->size) {
+        return a->size < b->size ? -1 : 1;
+    }
+    for (i = a->size - 1; i >= 0; i--) {
+        if (a->digit[i] != b->digit[i]) {
+            return a->digit[i] < b->digit[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/* a = a + b if b_sign is 0 or a = a - b if b_sign is 1, computed in the
+ * digit array of a if it has room, otherwise in a new one */
+static void
+bi_addsub_move(bigint_t* a, const bigint_t* b, u8 b_sign)
+{
+    u32 i, size = a->size > b->size ? a->size : b->size;
+    u128 carry = 0;
+    int cmp;
+    bigint_t c;
+    if (a->shared || a->nan || b->nan || BIPTR_IS_ZERO(a) || BIPTR_IS_ZERO(b)
+        || a->digit == b->digit || digits_capacity(a->digit) < size + 1) {
+        c = b_sign == b->sign ? bi_add(a, b) : bi_sub(a, b);
+        bi_free(a);
+        *a = c;
+        return;
+    }
+    if (size > a->size) {
+        memset(a->digit + a->size, 0, (size - a->size) * sizeof(u64));
+    }
+    if (a->sign == b_sign) {
+        for (i = 0; i < b->size; i++) {
+            carry += (u128)a->digit[i] + b->digit[i];
+            a->digit[i] = (u64)carry;
+            carry >>= BASE_SHIFT;
+        }
+        for (; i < size; i++) {
+            carry += a->digit[i];
+            a->digit[i] = (u64)carry;
+            carry >>= BASE_SHIFT;
+        }
+        a->digit[size] = (u64)carry;
+        a->size = size + 1;
+        bi_normalize(a);
+        return;
+    }
+    /* the sign of the result is the sign of the larger one */
+    cmp = bi_ucmp(a, b);
+    if (cmp == 0) {
+        bi_free(a);
+        return;
+    }
+    for (i = 0; i < b->size; i++) {
+        /* the borrow is kept in carry */
+        carry = cmp > 0 ? (u128)a->digit[i] - b->digit[i] - carry
+                        : (u128)b->digit[i] - a->digit[i] - carry;
+        a->digit[i] = (u64)carry;
+        carry = (carry >> BASE_SHIFT) & 1;
+    }
+    for (; i < size; i++) {
+        carry = (u128)a->digit[i] - carry;
+        a->digit[i] = (u64)carry;
+        carry = (carry >> BASE_SHIFT) & 1;
+    }
+    a->size = size;
+    if (cmp < 0) {
+        a->sign = b_sign;
+    }
+    bi_normalize(a);
+}
+
+/* a = a + b. the digit array of a is reused if it has room */
+void
+bi_add_move(bigint_t* a, const bigint_t* b)
+{
+    bi_addsub_move(a, b, b->sign);
+}
+
+/* a = a - b. the digit array of a is reused if it has room */
+void
+bi_sub_move(bigint_t* a, const bigint_t* b)
+{
+    bi_addsub_move(a, b, !b->sign);
+}
+
 inline bigint_t
 bi_mul(const bigint_t* a, const bigint_t* b)
 {
     bigint_t m = ZERO_BIGINT;
     bi_umul(&m, a, b);
-    if (a->sign != b->sign) {
-        m.sign = 1;
-    }
+    /* bi_umul copies the sign of the other operand when one is 1 */
+    m.sign = m.size != 0 && a->sign != b->sign;
     return m;
 }
 
@@ -888,16 +1820,14 @@ bi_mod(const bigint_t* a, const bigint_t* b)
     if (bi_eq(a, b)) {
         return ZERO_BIGINT;
     }
-    /* if |a| < |b|, return a */
-    int a_less_than_b = a->size == b->size
-        && (a->digit[a->size - 1] < b->digit[b->size - 1] || a->size < b->size);
-    if (a_less_than_b) {
+    /* if |a| < |b|, the remainder of |a| / |b| is |a| */
+    if (bi_ucmp(a, b) < 0) {
         bi_copy(&r, a);
-        return r;
+        r.sign = 0;
+    } else {
+        bi_udivmod(&q, &r, a, b);
+        bi_free(&q);
     }
-
-    bi_udivmod(&q, &r, a, b);
-    bi_free(&q);
     if (BIPTR_IS_ZERO((&r))) {
         return ZERO_BIGINT;
     }
@@ -912,22 +1842,232 @@ bi_mod(const bigint_t* a, const bigint_t* b)
     return r;
 }
 
+/* the bits of x[0:n] from the bit 64 * (n - 2) - s up for -2 <= s < 64 and
+ * n >= 3, which are its top bits if s is from its top digit */
+static inline u128
+digits_head(const u64* x, u32 n, int s)
+{
+    u128 h = ((u128)x[n - 1] << BASE_SHIFT) | x[n - 2];
+    if (s < 0) {
+        return h >> -s;
+    }
+    if (s > 0) {
+        h = (h << s) | (x[n - 3] >> (BASE_SHIFT - s));
+    }
+    return h;
+}
+
+/* the greatest common divisor of two double digits by the binary algorithm */
+static u128
+u128_gcd(u128 a, u128 b)
+{
+    int shift;
+    u128 t;
+    if (a == 0 || b == 0) {
+        return a | b;
+    }
+    shift = trailing_zeros(a | b);
+    a >>= trailing_zeros(a);
+    do {
+        b >>= trailing_zeros(b);
+        if (a > b) {
+            t = a;
+            a = b;
+            b = t;
+        }
+        b -= a;
+    } while (b != 0);
+    return a << shift;
+}
+
+static inline u128
+bi_low_u128(const bigint_t* x)
+{
+    if (x->size == 0) {
+        return 0;
+    }
+    if (x->size == 1) {
+        return x->digit[0];
+    }
+    return ((u128)x->digit[1] << BASE_SHIFT) | x->digit[0];
+}
+
+/*
+Explanation
+    Lehmer's algorithm from Donald Knuth's 'Art of Computer Programming,
+    Volume 2, Section 4.5.2 Algorithm L
+
+    the quotients of the euclidean algorithm are mostly decided by the top
+    digits. with the top 126 bits uh and vh of u and v, the quotient of u and
+    v is between (uh + A) / (vh + C) and (uh + B) / (vh + D), where A, B, C
+    and D are the cofactors of the steps done so far, starting from the
+    identity matrix. when the two bounds are equal, it is the quotient of u
+    and v, so the step is done on the heads and the cofactors only:
+
+      (A, B, C, D) = (C, D, A - q * C, B - q * D)
+      (uh, vh) = (vh, uh - q * vh)
+
+    when the bounds differ, all the steps are applied to u and v at once by
+    u = A * u + B * v and v = C * u + D * v. the cofactors are kept within
+    a digit so this is a linear pass that replaces about 64 bits of
+    euclidean steps, each of which would be a long division.
+*/
+bigint_t
+bi_gcd(const bigint_t* a, const bigint_t* b)
+{
+    bigint_t u = ZERO_BIGINT, v = ZERO_BIGINT, q = ZERO_BIGINT,
+             r = ZERO_BIGINT, g = ZERO_BIGINT;
+    i128 uh, vh, ca, cb, cc, cd, qj, ta, tb;
+    u128 g2;
+    u32 n;
+    int s, steps;
+    if (a->nan || b->nan) {
+        return NAN_BIGINT();
+    }
+    if (bi_ucmp(a, b) < 0) {
+        const bigint_t* tmp = a;
+        a = b;
+        b = tmp;
+    }
+    bi_copy(&u, a);
+    bi_copy(&v, b);
+    u.sign = v.sign = 0;
+    while (v.size > 2) {
+        n = u.size;
+        steps = 0;
+        if (n <= v.size + 1) {
+            if (v.size < n) {
+                bi_extend(&v, 1);
+            }
+            /* the heads leave room for the cofactors in an i128 */
+            s = 62 - bit_length(u.digit[n - 1]);
+            uh = digits_head(u.digit, n, s);
+            vh = digits_head(v.digit, n, s);
+            ca = cd = 1;
+            cb = cc = 0;
+            while (vh + cc > 0 && vh + cd > 0) {
+                qj = (uh + ca) / (vh + cc);
+                if (qj != (uh + cb) / (vh + cd) || qj > INT64_MAX) {
+                    break;
+                }
+                ta = ca - qj * cc;
+                tb = cb - qj * cd;
+                if (ta > INT64_MAX || ta < -INT64_MAX || tb > INT64_MAX
+                    || tb < -INT64_MAX) {
+                    break;
+                }
+                ca = cc;
+                cb = cd;
+                cc = ta;
+                cd = tb;
+                ta = (u128)uh - (u128)qj * (u128)vh;
+                uh = vh;
+                vh = ta;
+                steps++;
+            }
+            if (steps != 0) {
+                /* the cofactors alternate their signs with the steps */
+                digits_lehmer_update(
+                    u.digit, v.digit, n, ca < 0 ? -ca : ca, cb < 0 ? -cb : cb,
+                    cc < 0 ? -cc : cc, cd < 0 ? -cd : cd, steps & 1
+                );
+                bi_normalize(&u);
+            }
+            bi_normalize(&v);
+        }
+        if (steps == 0) {
+            /* the quotient is too large for the heads, do a division */
+            bi_udivmod(&q, &r, &u, &v);
+            bi_free(&q);
+            bi_free(&u);
+            u = v;
+            v = r;
+            r = ZERO_BIGINT;
+        }
+    }
+    if (v.size == 0) {
+        return u;
+    }
+    if (u.size > 2) {
+        bi_udivmod(&q, &r, &u, &v);
+        bi_free(&q);
+        bi_free(&u);
+        u = v;
+        v = r;
+    }
+    g2 = u128_gcd(bi_low_u128(&u), bi_low_u128(&v));
+    bi_free(&u);
+    bi_free(&v);
+    bi_new(&g, 2);
+    g.digit[0] = (u64)g2;
+    g.digit[1] = (u64)(g2 >> BASE_SHIFT);
+    bi_normalize(&g);
+    return g;
+}
+
+bigint_t
+bi_divexact(const bigint_t* a, const bigint_t* b)
+{
+    bigint_t q = ZERO_BIGINT;
+    u64 *x, *d;
+    u32 z = 0, s, an, dn;
+    if (BIPTR_IS_ZERO(b)) {
+        printf("bi_divexact: divided by zero\n");
+        return NAN_BIGINT();
+    }
+    if (BIPTR_IS_ZERO(a)) {
+        return ZERO_BIGINT;
+    }
+    /* long quotients by long divisors are left to the subquadratic
+     * division */
+    if (a->size - b->size >= DIV_DC_THRESHOLD && b->size >= DIV_DC_THRESHOLD) {
+        return bi_div(a, b);
+    }
+    /* remove the common trailing zeros so that the divisor is odd */
+    while (b->digit[z] == 0) {
+        z++;
+    }
+    s = trailing_zeros(b->digit[z]);
+    an = a->size - z;
+    dn = b->size - z;
+    x = bi_scratch_push(an + dn);
+    d = x + an;
+    digits_shr(x, a->digit + z, an, s);
+    digits_shr(d, b->digit + z, dn, s);
+    if (x[an - 1] == 0) {
+        an--;
+    }
+    if (d[dn - 1] == 0) {
+        dn--;
+    }
+    bi_new(&q, an - dn + 1);
+    digits_divexact(q.digit, x, an, d, dn);
+    bi_scratch_pop(x);
+    bi_normalize(&q);
+    if (a->sign != b->sign) {
+        q.sign = 1;
+    }
+    return q;
+}
+
 inline int
 bi_print(bigint_t* x, char end)
 {
-    int i, printed_bytes_count = 0;
+    u32 i;
+    int printed_bytes_count = 0;
     if (x->nan) {
         printed_bytes_count = printf("[BigInt NaN]");
         return printed_bytes_count;
     }
     printed_bytes_count
-        = printf("[BigInt sign=%d, size=%d, digit=", x->sign, x->size);
+        = printf("[BigInt sign=%d, size=%u, digit=", x->sign, x->size);
     fflush(stdout);
     if (BIPTR_IS_ZERO(x)) {
         return printed_bytes_count;
     }
     for (i = 0; i < x->size; i++) {
-        printed_bytes_count += printf("%8x, ", x->digit[i]);
+        printed_bytes_count
+            += printf("%16llx, ", (unsigned long long)x->digit[i]);
         fflush(stdout);
     }
     printed_bytes_count += printf("]");
@@ -959,35 +2099,42 @@ bi_to_dec_str(const bigint_t* x)
         dynarr_char_append(&string, "ZERO");
     } else {
         if (x->size == 1) {
-            figure_num = sprintf(buf, "%d", x->digit[0]);
-            for (i = 0; i < figure_num; i++) {
-                dynarr_char_append(&string, &buf[i]);
-            }
-            return string;
-        } else if (x->size == 2) {
-            figure_num = sprintf(
-                buf, "%llu",
-                (((unsigned long long)x->digit[1]) << BASE_SHIFT) | x->digit[0]
-            );
+            figure_num
+                = sprintf(buf, "%llu", (unsigned long long)x->digit[0]);
             for (i = 0; i < figure_num; i++) {
                 dynarr_char_append(&string, &buf[i]);
             }
             return string;
         } else {
+            /* divide by 10^19, the largest power of ten in a digit, and take
+             * 19 figures from each remainder */
+            u64 group_base_digit = 10000000000000000000ULL, group;
+            bigint_t group_base = {
+                .sign = 0,
+                .nan = 0,
+                .shared = 1,
+                .size = 1,
+                .digit = &group_base_digit,
+            };
             bigint_t y, q, r;
-            bigint_t ten = BYTE_BIGINT(10);
             dynarr_char_t reversed_digits = dynarr_char_new();
             char d;
+            int k;
             y = q = r = ZERO_BIGINT;
             bi_copy(&y, x);
             while (y.size != 0) {
-                bi_udivmod(&q, &r, &y, &ten);
-                d = (r.digit ? r.digit[0] : 0) + '0';
-                dynarr_char_append(&reversed_digits, &d);
+                bi_udivmod(&q, &r, &y, &group_base);
+                group = r.digit ? r.digit[0] : 0;
+                /* the leading zeros are only skipped in the highest group */
+                for (k = 0; k < 19 && (q.size != 0 || group != 0); k++) {
+                    d = group % 10 + '0';
+                    dynarr_char_append(&reversed_digits, &d);
+                    group /= 10;
+                }
                 bi_free(&y);
                 bi_free(&r);
-                bi_copy(&y, &q);
-                bi_free(&q);
+                y = q;
+                q = ZERO_BIGINT;
             }
             for (i = reversed_digits.size - 1; i >= 0; i--) {
                 dynarr_char_append(
@@ -996,9 +2143,6 @@ bi_to_dec_str(const bigint_t* x)
             }
             dynarr_char_free(&reversed_digits);
             bi_free(&y);
-            /* bi_free(&ten); */
-            bi_free(&q);
-            bi_free(&r);
         }
     }
     return string;
@@ -1066,10 +2210,10 @@ bi_from_str(const char* str)
         */
         /* bin & hex can determine needed size quickly */
         if (str[1] == 'x') {
-            safe_size = (str_length - 2) * 4 / 31 + 1;
+            safe_size = (str_length - 2) * 4 / BASE_SHIFT + 1;
             base = 16;
         } else if (str[1] == 'b') {
-            safe_size = (str_length - 2) / 31 + 1;
+            safe_size = (str_length - 2) / BASE_SHIFT + 1;
             base = 2;
         }
         str += 2;
@@ -1081,7 +2225,7 @@ bi_from_str(const char* str)
         /* set it bit by bit */
         for (i = 0, j = str_length - 1; i < str_length; i++, j--) {
             if (str[i] == '1') {
-                x.digit[j / 31] |= (1 << (j % 31));
+                x.digit[j / BASE_SHIFT] |= ((u64)1 << (j % BASE_SHIFT));
             }
         }
     } else {
@@ -1132,8 +2276,9 @@ bi_from_str(const char* str)
         }
         bi_free(&t1);
         bi_free(&t2);
-        bi_normalize(&x);
     }
+    /* the safe size can leave a leading zero digit */
+    bi_normalize(&x);
     x.sign = sign;
     return x;
 }
@@ -4,10 +4,9 @@
 #ifndef BIGINT_H
 #define BIGINT_H
 
-#define BASE_SHIFT 31
-#define DIGIT_BASE ((u32)1 << BASE_SHIFT)
-#define CARRY_MASK ((u32)1 << BASE_SHIFT)
-#define DIGIT_MASK (((u32)1 << BASE_SHIFT) - 1)
+/* digits are full 64-bit words, the products and carries are computed in
+ * 128-bit */
+#define BASE_SHIFT 64
 
 typedef uint8_t u8;
 typedef int32_t i32;
@@ -18,17 +17,17 @@ typedef uint64_t u64;
 typedef struct bigint {
     u8 sign;
     u8 nan;
-    u8 size; /* size is zero if the value is zero */
     u8 shared;
-    u32* digit;
+    u32 size; /* size is zero if the value is zero */
+    u64* digit;
 } bigint_t;
 
 #define bigint_struct_size sizeof(bigint_t)
 
 #define ZERO_BIGINT                                                            \
-    ((bigint_t) { .sign = 0, .nan = 0, .size = 0, .shared = 0, .digit = 0 })
+    ((bigint_t) { .sign = 0, .nan = 0, .shared = 0, .size = 0, .digit = 0 })
 #define NAN_BIGINT()                                                           \
-    ((bigint_t) { .sign = 0, .nan = 1, .size = 0, .shared = 0, .digit = 0 })
+    ((bigint_t) { .sign = 0, .nan = 1, .shared = 0, .size = 0, .digit = 0 })
 extern bigint_t BYTE_BIGINT(unsigned int b);
 
 extern void bi_new(bigint_t* x, u32 size);
@@ -43,6 +42,11 @@ extern bigint_t bi_sub(const bigint_t* a, const bigint_t* b);
 extern bigint_t bi_mul(const bigint_t* a, const bigint_t* b);
 extern bigint_t bi_div(const bigint_t* a, const bigint_t* b);
 extern bigint_t bi_mod(const bigint_t* a, const bigint_t* b);
+extern bigint_t bi_gcd(const bigint_t* a, const bigint_t* b);
+extern bigint_t bi_divexact(const bigint_t* a, const bigint_t* b);
+
+extern void bi_add_move(bigint_t* a, const bigint_t* b);
+extern void bi_sub_move(bigint_t* a, const bigint_t* b);
 
 extern int bi_print(bigint_t* x, char end);
 extern dynarr_char_t bi_to_dec_str(const bigint_t* x);
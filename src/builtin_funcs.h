@@ -14,13 +14,13 @@ builtin_func_input(const object_t* obj)
     int c;
     const char err_msg[]
         = "built-in function 'input': argument type should be null";
-    if (obj->type != TYPE_NULL) {
+    if (OBJ_TYPE(obj) != TYPE_NULL) {
         sprintf(ERR_MSG_BUF, err_msg);
         return (object_t*)ERR_OBJECT_PTR;
     }
     c = getchar();
     if (c != EOF) {
-        return object_create(TYPE_NUM, (object_data_union)number_from_i32(c));
+        return SMALL_INT_OBJECT(c);
     }
     return (object_t*)NULL_OBJECT_PTR;
 }
@@ -35,21 +35,34 @@ builtin_func_output(const object_t* obj)
           "but ";
     const char* err_msg_failed_to_write
         = "built-in function 'output': failed to write to stdout.";
+    number_t number_buf;
+    const number_t* number;
     /* check if obj is number */
-    if (obj->type != TYPE_NUM) {
-        sprintf(ERR_MSG_BUF, err_msg_not_number, OBJ_TYPE_SIG_STR[obj->type]);
+    if (OBJ_TYPE(obj) != TYPE_NUM) {
+        sprintf(
+            ERR_MSG_BUF, err_msg_not_number, OBJ_TYPE_SIG_STR[OBJ_TYPE(obj)]
+        );
         return (object_t*)ERR_OBJECT_PTR;
     }
+    /* bytes are always small integers */
+    if (IS_SMALL_INT(obj) && 0 <= SMALL_INT_VALUE(obj)
+        && SMALL_INT_VALUE(obj) < 256) {
+        if (fputc(SMALL_INT_VALUE(obj), stdout) == EOF) {
+            sprintf(ERR_MSG_BUF, "%s", err_msg_failed_to_write);
+            return (object_t*)ERR_OBJECT_PTR;
+        }
+        return (object_t*)NULL_OBJECT_PTR;
+    }
+    number = object_get_number(obj, &number_buf);
     /* if is not zero: check conditions */
-    if (obj->as.number.numer.size != 0) {
-        int is_pos = obj->as.number.numer.sign == 0;
-        int is_int = obj->as.number.denom.size == 1
-            && obj->as.number.denom.digit[0] == 1;
-        int is_less_than_256 = obj->as.number.numer.size == 1
-            && obj->as.number.numer.digit[0] < 256;
+    if (number->numer.size != 0) {
+        int is_pos = number->numer.sign == 0;
+        int is_int = number->denom.size == 1 && number->denom.digit[0] == 1;
+        int is_less_than_256 = number->numer.size == 1
+            && number->numer.digit[0] < 256;
         if (!is_pos || !is_int || !is_less_than_256) {
-            dynarr_char_t numer_dynarr = bi_to_dec_str(&obj->as.number.numer),
-                          denom_dynarr = bi_to_dec_str(&obj->as.number.denom);
+            dynarr_char_t numer_dynarr = bi_to_dec_str(&number->numer),
+                          denom_dynarr = bi_to_dec_str(&number->denom);
             char *numer_str = dynarr_char_to_str(&numer_dynarr),
                  *denom_str = dynarr_char_to_str(&denom_dynarr);
             sprintf(
@@ -62,10 +75,13 @@ builtin_func_output(const object_t* obj)
             free(denom_str);
             dynarr_char_free(&numer_dynarr);
             dynarr_char_free(&denom_dynarr);
+            if (number == &number_buf) {
+                number_free(&number_buf);
+            }
             return (object_t*)ERR_OBJECT_PTR;
         }
     }
-    if (fputc(obj->as.number.numer.digit[0], stdout) == EOF) {
+    if (fputc(number->numer.digit[0], stdout) == EOF) {
         sprintf(ERR_MSG_BUF, "%s", err_msg_failed_to_write);
         return (object_t*)ERR_OBJECT_PTR;
     }
@@ -82,21 +98,34 @@ builtin_func_error(const object_t* obj)
           "but [Number] (%s, %s)";
     const char* err_msg_failed_to_write
         = "built-in function 'error': failed to write to stdout.";
+    number_t number_buf;
+    const number_t* number;
     /* check if obj is number */
-    if (obj->type != TYPE_NUM) {
-        sprintf(ERR_MSG_BUF, err_msg_not_number, OBJ_TYPE_SIG_STR[obj->type]);
+    if (OBJ_TYPE(obj) != TYPE_NUM) {
+        sprintf(
+            ERR_MSG_BUF, err_msg_not_number, OBJ_TYPE_SIG_STR[OBJ_TYPE(obj)]
+        );
         return (object_t*)ERR_OBJECT_PTR;
     }
+    /* bytes are always small integers */
+    if (IS_SMALL_INT(obj) && 0 <= SMALL_INT_VALUE(obj)
+        && SMALL_INT_VALUE(obj) < 256) {
+        if (fputc(SMALL_INT_VALUE(obj), stderr) == EOF) {
+            sprintf(ERR_MSG_BUF, "%s", err_msg_failed_to_write);
+            return (object_t*)ERR_OBJECT_PTR;
+        }
+        return (object_t*)NULL_OBJECT_PTR;
+    }
+    number = object_get_number(obj, &number_buf);
     /* if is not zero: check conditions */
-    if (obj->as.number.numer.size != 0) {
-        int is_pos = obj->as.number.numer.sign == 0;
-        int is_int = obj->as.number.denom.size == 1
-            && obj->as.number.denom.digit[0] == 1;
-        int is_less_than_256 = obj->as.number.numer.size == 1
-            && obj->as.number.numer.digit[0] < 256;
+    if (number->numer.size != 0) {
+        int is_pos = number->numer.sign == 0;
+        int is_int = number->denom.size == 1 && number->denom.digit[0] == 1;
+        int is_less_than_256 = number->numer.size == 1
+            && number->numer.digit[0] < 256;
         if (!is_pos || !is_int || !is_less_than_256) {
-            dynarr_char_t numer_dynarr = bi_to_dec_str(&obj->as.number.numer),
-                          denom_dynarr = bi_to_dec_str(&obj->as.number.denom);
+            dynarr_char_t numer_dynarr = bi_to_dec_str(&number->numer),
+                          denom_dynarr = bi_to_dec_str(&number->denom);
             char *numer_str = dynarr_char_to_str(&numer_dynarr),
                  *denom_str = dynarr_char_to_str(&denom_dynarr);
             sprintf(
@@ -108,10 +137,13 @@ builtin_func_error(const object_t* obj)
             free(denom_str);
             dynarr_char_free(&numer_dynarr);
             dynarr_char_free(&denom_dynarr);
+            if (number == &number_buf) {
+                number_free(&number_buf);
+            }
             return (object_t*)ERR_OBJECT_PTR;
         }
     }
-    if (fputc(obj->as.number.numer.digit[0], stderr) == EOF) {
+    if (fputc(number->numer.digit[0], stderr) == EOF) {
         sprintf(ERR_MSG_BUF, "%s", err_msg_failed_to_write);
         return (object_t*)ERR_OBJECT_PTR;
     }
@@ -121,25 +153,19 @@ builtin_func_error(const object_t* obj)
 static object_t*
 builtin_func_is_number(const object_t* obj)
 {
-    return object_create(
-        TYPE_NUM, (object_data_union)number_from_i32(obj->type == TYPE_NUM)
-    );
+    return SMALL_INT_OBJECT(OBJ_TYPE(obj) == TYPE_NUM);
 }
 
 static object_t*
 builtin_func_is_callable(const object_t* obj)
 {
-    return object_create(
-        TYPE_NUM, (object_data_union)number_from_i32(obj->type == TYPE_CALL)
-    );
+    return SMALL_INT_OBJECT(OBJ_TYPE(obj) == TYPE_CALL);
 }
 
 static object_t*
 builtin_func_is_pair(const object_t* obj)
 {
-    return object_create(
-        TYPE_NUM, (object_data_union)number_from_i32(obj->type == TYPE_PAIR)
-    );
+    return SMALL_INT_OBJECT(OBJ_TYPE(obj) == TYPE_PAIR);
 }
 
 static object_t*
@@ -1,80 +1,74 @@
 #include "bytecode.h"
 #include "utils/errormsg.h"
 
+static void
+line_table_append(
+    dynarr_bytecode_pos_t* line_table, const int index, const linecol_t pos
+)
+{
+    bytecode_pos_t* last = dynarr_bytecode_pos_back(line_table);
+    bytecode_pos_t entry = { .index = index, .pos = pos };
+    if (last != NULL && last->pos.line == pos.line
+        && last->pos.col == pos.col) {
+        return;
+    }
+    if (last != NULL && last->index == index) {
+        /* the last entry covers no bytecode, just overwrite it */
+        *last = entry;
+        return;
+    }
+    dynarr_bytecode_pos_append(line_table, &entry);
+}
+
 void
 bytecode_array_extend(
-    dynarr_bytecode_t* arr, bytecode_op_code_enum op_code, uint32_t full_arg,
-    linecol_t pos
+    dynarr_bytecode_t* arr, dynarr_bytecode_pos_t* line_table,
+    bytecode_op_code_enum op_code, uint32_t arg, linecol_t pos
 )
 {
-    if (full_arg <= 0xFFu) {
-        bytecode_t bc = {
-            .op = op_code,
-            .arg = (uint8_t)(full_arg),
-            .pos = pos,
-        };
-        dynarr_bytecode_append(arr, &bc);
-    } else if (full_arg <= 0xFFFFu) {
-        bytecode_t bc1 = {
-            .op = BOP_EXTEND_ARG,
-            .arg = (uint8_t)(full_arg >> 8),
-            .pos = pos,
-        };
-        bytecode_t bc0 = {
-            .op = op_code,
-            .arg = (uint8_t)(full_arg),
-            .pos = pos,
-        };
-        dynarr_bytecode_append(arr, &bc1);
-        dynarr_bytecode_append(arr, &bc0);
-    } else if (full_arg <= 0xFFFFFFu) {
-        bytecode_t bc2 = {
-            .op = BOP_EXTEND_ARG,
-            .arg = (uint8_t)(full_arg >> 16),
-            .pos = pos,
-        };
-        bytecode_t bc1 = {
-            .op = BOP_EXTEND_ARG,
-            .arg = (uint8_t)(full_arg >> 8),
-            .pos = pos,
-        };
-        bytecode_t bc0 = {
-            .op = op_code,
-            .arg = (uint8_t)(full_arg),
-            .pos = pos,
-        };
-        dynarr_bytecode_append(arr, &bc2);
-        dynarr_bytecode_append(arr, &bc1);
-        dynarr_bytecode_append(arr, &bc0);
-    } else if (full_arg <= 0x7FFFFFFFu) {
-        bytecode_t bc3 = {
-            .op = BOP_EXTEND_ARG,
-            .arg = (uint8_t)(full_arg >> 24),
-            .pos = pos,
-        };
-        bytecode_t bc2 = {
-            .op = BOP_EXTEND_ARG,
-            .arg = (uint8_t)(full_arg >> 16),
-            .pos = pos,
-        };
-        bytecode_t bc1 = {
-            .op = BOP_EXTEND_ARG,
-            .arg = (uint8_t)(full_arg >> 8),
-            .pos = pos,
-        };
-        bytecode_t bc0 = {
-            .op = op_code,
-            .arg = (uint8_t)(full_arg),
-            .pos = pos,
-        };
-        dynarr_bytecode_append(arr, &bc3);
-        dynarr_bytecode_append(arr, &bc2);
-        dynarr_bytecode_append(arr, &bc1);
-        dynarr_bytecode_append(arr, &bc0);
-    } else {
-        print_runtime_error((linecol_t) { 0, 0 }, "bytecode arg too large");
-        exit(OTHER_ERR_CODE);
+    bytecode_t bc = {
+        .op = op_code,
+        .arg = arg,
+    };
+    line_table_append(line_table, arr->size, pos);
+    dynarr_bytecode_append(arr, &bc);
+}
+
+/* append src_arr to arr and src_line_table to line_table */
+void
+bytecode_array_concat(
+    dynarr_bytecode_t* arr, dynarr_bytecode_pos_t* line_table,
+    dynarr_bytecode_t* src_arr, const dynarr_bytecode_pos_t* src_line_table
+)
+{
+    int i;
+    for (i = 0; i < src_line_table->size; i++) {
+        line_table_append(
+            line_table, arr->size + src_line_table->data[i].index,
+            src_line_table->data[i].pos
+        );
+    }
+    dynarr_bytecode_concat(arr, src_arr);
+}
+
+/* find the source position of the bytecode at index */
+linecol_t
+bytecode_pos_lookup(const dynarr_bytecode_pos_t* line_table, int index)
+{
+    int lo = 0, hi = line_table->size - 1;
+    if (hi < 0 || index < line_table->data[0].index) {
+        return (linecol_t) { 0, 0 };
+    }
+    /* find the last entry whose index is not greater than index */
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (line_table->data[mid].index <= index) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
     }
+    return line_table->data[lo].pos;
 }
 
 int
@@ -82,9 +76,10 @@ bytecode_has_arg(bytecode_op_code_enum bop)
 {
     return (
         bop == BOP_BIND_ARG || bop == BOP_MAKE_FUNCT || bop == BOP_MAKE_MACRO
-        || bop == BOP_FGET || bop == BOP_FSET || bop == BOP_FSET_UNPACK
-        || bop == BOP_EXTEND_ARG || bop == BOP_PUSH_LIT || bop == BOP_BF_OR_POP
-        || bop == BOP_BT_OR_POP
+        || bop == BOP_FGET_LOCAL || bop == BOP_FGET_GLOBAL || bop == BOP_FGET
+        || bop == BOP_FSET_LOCAL || bop == BOP_FSET_GLOBAL || bop == BOP_FSET
+        || bop == BOP_FSET_UNPACK || bop == BOP_PUSH_LIT
+        || bop == BOP_BF_OR_POP || bop == BOP_BT_OR_POP
     );
 }
 
@@ -119,12 +114,14 @@ op_to_bop_code(op_code_enum op_code)
 int
 bytecode_stack_diff(bytecode_op_code_enum bop)
 {
-    if (bop == BOP_PUSH_LIT || bop == BOP_FGET || bop == BOP_FSET_LIT
-        || bop == BOP_MAKE_FUNCT || bop == BOP_MAKE_MACRO) {
+    if (bop == BOP_PUSH_LIT || bop == BOP_FGET_LOCAL || bop == BOP_FGET_GLOBAL
+        || bop == BOP_FGET || bop == BOP_FSET_LIT || bop == BOP_MAKE_FUNCT
+        || bop == BOP_MAKE_MACRO) {
         return 1;
     }
-    if (bop == BOP_NOP || bop == BOP_EXTEND_ARG || bop == BOP_FSET
-        || bop == BOP_FSET_UNPACK || bop == BOP_RET || bop == BOP_NEG
+    if (bop == BOP_NOP || bop == BOP_FSET_LOCAL || bop == BOP_FSET_GLOBAL
+        || bop == BOP_FSET || bop == BOP_FSET_UNPACK || bop == BOP_RET
+        || bop == BOP_NEG
         || bop == BOP_NOT || bop == BOP_CEIL || bop == BOP_FLOOR
         || bop == BOP_PGETL || bop == BOP_PGETR || bop == BOP_COND_CALL
         || bop == BOP_SWAP || bop == BOP_BIND_ARG) {
@@ -8,7 +8,6 @@
 
 typedef enum bytecode_op_code {
     BOP_NOP,
-    BOP_EXTEND_ARG,
 
     /**
      * frame & stack manipulation
@@ -16,9 +15,17 @@ typedef enum bytecode_op_code {
 
     /* push a literal object to object stack */
     BOP_PUSH_LIT,
-    /* get object from frame and push to object stack */
+    /* get object of local address from frame and push to object stack */
+    BOP_FGET_LOCAL,
+    /* get object of global id code from frame and push to object stack */
+    BOP_FGET_GLOBAL,
+    /* look up object of id code in frame and push to object stack */
     BOP_FGET,
-    /* set object from top of stack to frame */
+    /* set object from top of stack to local address of frame */
+    BOP_FSET_LOCAL,
+    /* set object from top of stack to global id code of frame */
+    BOP_FSET_GLOBAL,
+    /* set object from top of stack to id code of frame */
     BOP_FSET,
     /* set literal object to frame and push to object stack */
     BOP_FSET_LIT,
@@ -81,9 +88,12 @@ typedef enum bytecode_op_code {
 
 static const char* const BYTECODE_OP_NAMES[BOP_END_Of_ENUM] = {
     "NOP",
-    "EXTEND_ARG",
     "PUSH_LIT",
+    "FGET_LOCAL",
+    "FGET_GLOBAL",
     "FGET",
+    "FSET_LOCAL",
+    "FSET_GLOBAL",
     "FSET",
     "FSET_LIT",
     "FSET_UNPACK",
@@ -163,10 +173,11 @@ static const int OP_TO_BOP_MAPPING[][2] = {
     { OP_COND_PCALL, BOP_COND_PCALL },
 };
 
+/* every bytecode has a full 32-bit argument so that it is executed with
+ * exactly one dispatch */
 typedef struct bytecode {
     uint8_t op;
-    uint8_t arg;
-    linecol_t pos;
+    uint32_t arg;
 } bytecode_t;
 
 #define TYPE bytecode_t
@@ -175,11 +186,35 @@ typedef struct bytecode {
 #undef TYPE_NAME
 #undef TYPE
 
+/* An entry of the line table. The source position of bytecodes are kept out
+ * of the bytecode array because they are only needed when reporting errors.
+ * Consecutive bytecodes of the same position share one entry, which covers
+ * the bytecodes from its index to the index of the next entry.
+ */
+typedef struct bytecode_pos {
+    int index;
+    linecol_t pos;
+} bytecode_pos_t;
+
+#define TYPE bytecode_pos_t
+#define TYPE_NAME bytecode_pos
+#include "utils/dynarr.tmpl.h"
+#undef TYPE_NAME
+#undef TYPE
+
 void bytecode_array_extend(
-    dynarr_bytecode_t* arr, bytecode_op_code_enum op_code, uint32_t full_arg,
-    linecol_t pos
+    dynarr_bytecode_t* arr, dynarr_bytecode_pos_t* line_table,
+    bytecode_op_code_enum op_code, uint32_t arg, linecol_t pos
 );
 
+void bytecode_array_concat(
+    dynarr_bytecode_t* arr, dynarr_bytecode_pos_t* line_table,
+    dynarr_bytecode_t* src_arr, const dynarr_bytecode_pos_t* src_line_table
+);
+
+linecol_t
+bytecode_pos_lookup(const dynarr_bytecode_pos_t* line_table, int index);
+
 int bytecode_print(const bytecode_t bytecode);
 
 bytecode_op_code_enum op_to_bop_code(op_code_enum op_code);
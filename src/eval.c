@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* return 1 and write the error message to ERR_MSG_BUF if type is bad */
 static inline int
 is_bad_type(
     bytecode_t bytecode, int left_good_type, int right_good_type,
@@ -20,14 +21,14 @@ is_bad_type(
     } else if (left_good_type == ANY_TYPE) {
         left_passed = left != NULL;
     } else {
-        left_passed = left != NULL && left->type == left_good_type;
+        left_passed = left != NULL && OBJ_TYPE(left) == left_good_type;
     }
     if (right_good_type == NO_OPERAND) {
         right_passed = right == NULL;
     } else if (right_good_type == ANY_TYPE) {
         right_passed = right != NULL;
     } else {
-        right_passed = right != NULL && right->type == right_good_type;
+        right_passed = right != NULL && OBJ_TYPE(right) == right_good_type;
     }
     if (left_passed && right_passed) {
         return 0;
@@ -38,124 +39,452 @@ is_bad_type(
         BYTECODE_OP_NAMES[bytecode.op],
         left_good_type < 0 ? "" : OBJ_TYPE_SIG_STR[left_good_type],
         right_good_type < 0 ? "" : OBJ_TYPE_SIG_STR[right_good_type],
-        left == NULL ? "" : OBJ_TYPE_SIG_STR[left->type],
-        right == NULL ? "" : OBJ_TYPE_SIG_STR[right->type]
+        left == NULL ? "" : OBJ_TYPE_SIG_STR[OBJ_TYPE(left)],
+        right == NULL ? "" : OBJ_TYPE_SIG_STR[OBJ_TYPE(right)]
     );
-    print_runtime_error(bytecode.pos, ERR_MSG_BUF);
     return 1;
 }
 
+/* An entry of the operand stack is borrowed if its object is loaded from a
+ * frame, a literal or a borrowed pair, which keeps it alive while the frame
+ * of the running function is alive. Pushing and popping a borrowed entry
+ * does not touch the reference count. The entry is owned, which means it
+ * holds a count, before the frame can be freed: when it is returned and
+ * before a tail call replaces the frame. Storing the object in a frame or a
+ * pair counts a reference of its own.
+ *
+ * A borrowed entry is the object pointer with the second lowest bit set,
+ * which is never set in the address of an object. Small integers are never
+ * borrowed. */
+#define BORROWED_BIT 2
+#define IS_BORROWED(entry) ((((uintptr_t)(entry)) & 3) == BORROWED_BIT)
+#define BORROW(obj)                                                            \
+    (IS_SMALL_INT(obj) ? (obj) : (object_t*)((uintptr_t)(obj) | BORROWED_BIT))
+#define ENTRY_OBJECT(entry)                                                    \
+    (IS_BORROWED(entry) ? (object_t*)((uintptr_t)(entry) ^ BORROWED_BIT)      \
+                        : (entry))
+
+/* drop the entry's reference. only owned object entries hold one */
+#define ENTRY_RELEASE(entry)                                                   \
+    do {                                                                       \
+        if ((((uintptr_t)(entry)) & 3) == 0) {                                 \
+            object_deref(entry);                                               \
+        }                                                                      \
+    } while (0)
+
+/* make the entry hold a reference of its object */
+#define ENTRY_OWN(entry)                                                       \
+    do {                                                                       \
+        if (IS_BORROWED(entry)) {                                              \
+            (entry) = object_ref(ENTRY_OBJECT(entry));                         \
+        }                                                                      \
+    } while (0)
+
+/* is the entry the only reference of a number object, so that the object
+ * can be reused for the result of an operator on it */
+#define IS_UNIQUE_NUMBER(entry)                                                \
+    ((((uintptr_t)(entry)) & 3) == 0 && !(entry)->is_const                     \
+     && (entry)->ref_count == 1)
+
 /* return 1 if check result is bad */
 static inline int
 pop_l_check(
-    dynarr_object_ptr_t* stack, bytecode_t bc, object_t** left_ptr,
-    object_type_enum left_good_type
+    dynarr_object_ptr_t* stack, bytecode_t bc, object_t** left_entry,
+    object_t** left_ptr, object_type_enum left_good_type
 )
 {
-    *left_ptr = *dynarr_object_ptr_back(stack);
+    *left_entry = *dynarr_object_ptr_back(stack);
     dynarr_object_ptr_pop(stack);
+    *left_ptr = ENTRY_OBJECT(*left_entry);
     return is_bad_type(bc, left_good_type, NO_OPERAND, *left_ptr, NULL);
 }
 
 /* return 1 if check result is bad */
 static inline int
 pop_lr_check(
-    dynarr_object_ptr_t* stack, bytecode_t bc, object_t** left_ptr,
-    object_t** right_ptr, object_type_enum left_good_type,
-    object_type_enum right_good_type
+    dynarr_object_ptr_t* stack, bytecode_t bc, object_t** left_entry,
+    object_t** right_entry, object_t** left_ptr, object_t** right_ptr,
+    object_type_enum left_good_type, object_type_enum right_good_type
 )
 {
-    *right_ptr = *dynarr_object_ptr_back(stack);
+    *right_entry = *dynarr_object_ptr_back(stack);
     dynarr_object_ptr_pop(stack);
-    *left_ptr = *dynarr_object_ptr_back(stack);
+    *left_entry = *dynarr_object_ptr_back(stack);
     dynarr_object_ptr_pop(stack);
+    *left_ptr = ENTRY_OBJECT(*left_entry);
+    *right_ptr = ENTRY_OBJECT(*right_entry);
     return is_bad_type(
         bc, left_good_type, right_good_type, *left_ptr, *right_ptr
     );
 }
 
-registers_t*
-eval_bytecode(context_t context, bytecode_t bc)
+/* the result of a number operator on objects that are not both small
+ * integers, or whose result does not fit in one */
+static inline object_t*
+number_binop(
+    number_t (*op)(number_t*, number_t*), object_t* left, object_t* right
+)
+{
+    number_t lbuf, rbuf;
+    number_t* l = (number_t*)object_get_number(left, &lbuf);
+    number_t* r = (number_t*)object_get_number(right, &rbuf);
+    object_t* result = object_from_number(op(l, r));
+    if (l == &lbuf) {
+        number_free(&lbuf);
+    }
+    if (r == &rbuf) {
+        number_free(&rbuf);
+    }
+    return result;
+}
+
+/* the result of a number operator written into the number of dst, which is
+ * not referenced by anything else */
+static inline object_t*
+number_binop_move(
+    void (*op)(number_t*, number_t*), object_t* dst, object_t* other
+)
+{
+    number_t buf;
+    number_t* r = (number_t*)object_get_number(other, &buf);
+    op(&dst->as.number, r);
+    if (r == &buf) {
+        number_free(&buf);
+    }
+    return object_renew_number(dst);
+}
+
+static inline int
+number_object_lt(object_t* left, object_t* right)
 {
+    number_t lbuf, rbuf;
+    number_t* l;
+    number_t* r;
+    int result;
+    if (IS_SMALL_INT(left) && IS_SMALL_INT(right)) {
+        return SMALL_INT_VALUE(left) < SMALL_INT_VALUE(right);
+    }
+    l = (number_t*)object_get_number(left, &lbuf);
+    r = (number_t*)object_get_number(right, &rbuf);
+    result = number_lt(l, r);
+    if (l == &lbuf) {
+        number_free(&lbuf);
+    }
+    if (r == &rbuf) {
+        number_free(&rbuf);
+    }
+    return result;
+}
+
+#define BOTH_SMALL_INT(a, b) (IS_SMALL_INT(a) && IS_SMALL_INT(b))
+#define BOOL_OBJECT(b) SMALL_INT_OBJECT((b) ? 1 : 0)
+
+/* small integers are one bit shorter than intptr_t so only multiplication
+ * can overflow before the range check */
+#if defined(__GNUC__)
+#define MUL_OVERFLOW(a, b, res) __builtin_mul_overflow(a, b, res)
+#else
+#define MUL_OVERFLOW(a, b, res) 1
+#endif
+
+/* Use computed goto ("labels as values") to dispatch bytecode if the compiler
+ * supports it, so that every handler jumps directly to the next one. Define
+ * NO_COMPUTED_GOTO to force the portable switch-based dispatch.
+ */
+#if defined(__GNUC__) && !defined(NO_COMPUTED_GOTO)
+#define USE_COMPUTED_GOTO
+#endif
+
+#ifdef ENABLE_DEBUG_LOG
+static void
+eval_trace(const dynarr_object_ptr_t* stack, uint32_t insp, bytecode_t bc)
+{
+    int i;
+    if (!global_is_enable_debug_log) {
+        return;
+    }
+    printf("inst=%d, arg=%u, object_stack=[", insp, bc.arg);
+    for (i = 0; i < stack->size; i++) {
+        object_print(ENTRY_OBJECT(stack->data[i]), ',');
+        printf(" ");
+    }
+    printf("]\n");
+    printf("exec bytecode: ");
+    bytecode_print(bc);
+    printf("\n");
+}
+#define TRACE_BYTECODE() eval_trace(stack, insp, bc)
+#else
+#define TRACE_BYTECODE()
+#endif
+
+/* increase insp before bytecode is execute so we don't need to worried
+ * about jump and call and ret
+ */
+#define FETCH_BYTECODE()                                                       \
+    do {                                                                       \
+        bc = bytecodes[insp];                                                  \
+        TRACE_BYTECODE();                                                      \
+        insp++;                                                                \
+    } while (0)
+
+#ifdef USE_COMPUTED_GOTO
+#define TARGET(op) target_##op:
+#define DISPATCH()                                                             \
+    {                                                                          \
+        FETCH_BYTECODE();                                                      \
+        goto* dispatch_table[bc.op];                                           \
+    }
+#else
+#define TARGET(op) case op:
+/* no do-while wrapping here because the continue is for the dispatch loop */
+#define DISPATCH() continue
+#endif
+
+/* the call stack is changed by call and return so the cached values have to
+ * be written back and re-loaded around them
+ */
+#define SAVE_REGISTERS() (act->insp = insp)
+#define LOAD_REGISTERS()                                                       \
+    do {                                                                       \
+        act = dynarr_activation_back(context.call_stack);                      \
+        cur_frame = act->frame;                                                \
+        insp = act->insp;                                                      \
+    } while (0)
+
+/* a call is at tail position if it is immediately followed by return. the
+ * root frame owns the globals so calls from root are never tail calls. a
+ * frame with open holes is still read by the functions created in it, so it
+ * can not be replaced either */
+#define IS_TAIL_CALL()                                                         \
+    (bytecodes[insp].op == BOP_RET && context.call_stack->size > 1            \
+     && cur_frame->holes == NULL)
+
+#define STACK_TOP() (stack->data[stack->size - 1])
+#define STACK_POP() (stack->data[--stack->size])
+#define STACK_PUSH(obj) (stack->data[stack->size++] = (obj))
+
+#define SET_ERROR()                                                            \
+    do {                                                                       \
+        act->errf = 1;                                                         \
+        goto eval_end;                                                         \
+    } while (0)
+
+/* the position of current bytecode is only looked up when reporting error */
+#define BYTECODE_POS() syntax_tree_get_bytecode_pos(context.tree, insp - 1)
+
+#define RUNTIME_ERROR(msg)                                                     \
+    do {                                                                       \
+        print_runtime_error(BYTECODE_POS(), msg);                              \
+        SET_ERROR();                                                           \
+    } while (0)
+
+void
+eval(context_t context)
+{
+    const bytecode_t* bytecodes = context.tree->bytecodes.data;
     dynarr_object_ptr_t* stack = context.object_stack;
-    frame_t* cur_frame = *dynarr_frameptr_back(context.frame_stack);
-    registers_t* regs = dynarr_registers_back(context.regs_stack);
+    activation_t* act = dynarr_activation_back(context.call_stack);
+    frame_t* cur_frame = act->frame;
+    uint32_t insp = act->insp;
+    bytecode_t bc;
     object_t* left;
     object_t* right;
-    object_t* tmp = NULL;
-
-    /* increase insp before bytecode is execute so we don't need to worried
-     * about jump and call and ret
-     */
-    regs->insp++;
-
-    switch (bc.op) {
-    case BOP_NOP:
-        break;
-    case BOP_EXTEND_ARG:
-        regs->arg = (regs->arg | bc.arg) << 8;
-        break;
-    case BOP_PUSH_LIT:
-        regs->arg = regs->arg | bc.arg;
-        tmp = object_ref(context.tree->literals[regs->arg]);
-        dynarr_object_ptr_append(stack, &tmp);
-        break;
-    case BOP_FGET:
-        regs->arg = regs->arg | bc.arg;
-        tmp = frame_get(cur_frame, regs->arg);
+    object_t* left_entry;
+    object_t* right_entry;
+    object_t* tmp;
+
+#ifdef USE_COMPUTED_GOTO
+    /* must be in the same order as bytecode_op_code_enum */
+    static const void* const dispatch_table[BOP_END_Of_ENUM] = {
+        &&target_BOP_NOP,
+        &&target_BOP_PUSH_LIT,
+        &&target_BOP_FGET_LOCAL,
+        &&target_BOP_FGET_GLOBAL,
+        &&target_BOP_FGET,
+        &&target_BOP_FSET_LOCAL,
+        &&target_BOP_FSET_GLOBAL,
+        &&target_BOP_FSET,
+        &&bad_bytecode, /* BOP_FSET_LIT */
+        &&target_BOP_FSET_UNPACK,
+        &&target_BOP_POP,
+        &&target_BOP_RET,
+        &&target_BOP_BF_OR_POP,
+        &&target_BOP_BT_OR_POP,
+        &&target_BOP_MAKE_FUNCT,
+        &&target_BOP_MAKE_MACRO,
+        &&target_BOP_CALL,
+#if DEPRECATED
+        &&target_BOP_MAP,
+        &&target_BOP_FILTER,
+        &&target_BOP_REDUCE,
+#endif
+        &&target_BOP_NEG,
+        &&target_BOP_NOT,
+        &&target_BOP_CEIL,
+        &&target_BOP_FLOOR,
+        &&target_BOP_PGETL,
+        &&target_BOP_PGETR,
+        &&target_BOP_COND_CALL,
+        &&target_BOP_SWAP,
+        &&target_BOP_EXP,
+        &&target_BOP_MUL,
+        &&target_BOP_DIV,
+        &&target_BOP_MOD,
+        &&target_BOP_ADD,
+        &&target_BOP_SUB,
+        &&target_BOP_LT,
+        &&target_BOP_LE,
+        &&target_BOP_GT,
+        &&target_BOP_GE,
+        &&target_BOP_EQ,
+        &&target_BOP_NE,
+        &&target_BOP_AND,
+        &&target_BOP_OR,
+        &&target_BOP_PAIR,
+        &&target_BOP_BIND_ARG,
+        &&target_BOP_COND_PGET,
+        &&target_BOP_COND_PCALL,
+    };
+    /* begin evaluation */
+    DISPATCH();
+#else
+    /* begin evaluation */
+    while (1) {
+        FETCH_BYTECODE();
+        switch (bc.op) {
+#endif
+
+    TARGET(BOP_NOP)
+    {
+        DISPATCH();
+    }
+    TARGET(BOP_PUSH_LIT)
+    {
+        tmp = BORROW(context.tree->literals[bc.arg]);
+        STACK_PUSH(tmp);
+        DISPATCH();
+    }
+    TARGET(BOP_FGET_LOCAL)
+    {
+        tmp = frame_get_local(cur_frame, bc.arg);
+        if (tmp == NULL) {
+            const char* err_msg = "Identifier '%s' used uninitialized";
+            int code = frame_get_local_code(cur_frame, bc.arg);
+            sprintf(ERR_MSG_BUF, err_msg, context.tree->id_code_str_map[code]);
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        tmp = BORROW(tmp);
+        STACK_PUSH(tmp);
+        DISPATCH();
+    }
+    TARGET(BOP_FGET_GLOBAL)
+    {
+        tmp = frame_get_global(cur_frame, bc.arg);
         if (tmp == NULL) {
             const char* err_msg = "Identifier '%s' used uninitialized";
             sprintf(
-                ERR_MSG_BUF, err_msg, context.tree->id_code_str_map[regs->arg]
+                ERR_MSG_BUF, err_msg, context.tree->id_code_str_map[bc.arg]
             );
-            print_runtime_error(bc.pos, ERR_MSG_BUF);
-            regs->errf = 1;
-        } else {
-            tmp = object_ref(tmp);
-            dynarr_object_ptr_append(stack, &tmp);
-        }
-        break;
-    case BOP_FSET:
-        regs->arg = regs->arg | bc.arg;
-        tmp = *dynarr_object_ptr_back(stack);
-        if (!tmp || !frame_set(cur_frame, regs->arg, tmp)) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        tmp = BORROW(tmp);
+        STACK_PUSH(tmp);
+        DISPATCH();
+    }
+    TARGET(BOP_FGET)
+    {
+        tmp = frame_get(cur_frame, bc.arg);
+        if (tmp == NULL) {
+            const char* err_msg = "Identifier '%s' used uninitialized";
+            sprintf(
+                ERR_MSG_BUF, err_msg, context.tree->id_code_str_map[bc.arg]
+            );
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        tmp = BORROW(tmp);
+        STACK_PUSH(tmp);
+        DISPATCH();
+    }
+    TARGET(BOP_FSET_LOCAL)
+    {
+        tmp = ENTRY_OBJECT(STACK_TOP());
+        if (!tmp || !frame_set_local(cur_frame, bc.arg, tmp)) {
+            const char* err_msg = "Repeated initialization of identifier '%s'";
+            int code = frame_get_local_code(cur_frame, bc.arg);
+            sprintf(ERR_MSG_BUF, err_msg, context.tree->id_code_str_map[code]);
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        if (OBJ_IS_ERROR(tmp)) {
+            SET_ERROR();
+        }
+        DISPATCH();
+    }
+    TARGET(BOP_FSET_GLOBAL)
+    {
+        tmp = ENTRY_OBJECT(STACK_TOP());
+        if (!tmp || !frame_set_global(cur_frame, bc.arg, tmp)) {
             const char* err_msg = "Repeated initialization of identifier '%s'";
             sprintf(
-                ERR_MSG_BUF, err_msg, context.tree->id_code_str_map[regs->arg]
+                ERR_MSG_BUF, err_msg, context.tree->id_code_str_map[bc.arg]
             );
-            print_runtime_error(bc.pos, ERR_MSG_BUF);
-            regs->errf = 1;
-        }
-        break;
-    case BOP_FSET_UNPACK:
-        regs->arg = regs->arg | bc.arg;
-        tmp = *dynarr_object_ptr_back(stack);
-        if (tmp->type != TYPE_PAIR) {
-            regs->errf = 1;
-            break;
-        }
-        exec_frame_set_unpack(context, bc.pos, regs->arg, tmp);
-        break;
-    case BOP_POP:
-        tmp = *dynarr_object_ptr_back(stack);
-        dynarr_object_ptr_pop(stack);
-        object_deref(tmp);
-        tmp = NULL;
-        break;
-    case BOP_RET:
-        dynarr_registers_pop(context.regs_stack);
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        if (OBJ_IS_ERROR(tmp)) {
+            SET_ERROR();
+        }
+        DISPATCH();
+    }
+    TARGET(BOP_FSET)
+    {
+        tmp = ENTRY_OBJECT(STACK_TOP());
+        if (!tmp || !frame_set(cur_frame, bc.arg, tmp)) {
+            const char* err_msg = "Repeated initialization of identifier '%s'";
+            sprintf(
+                ERR_MSG_BUF, err_msg, context.tree->id_code_str_map[bc.arg]
+            );
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        if (OBJ_IS_ERROR(tmp)) {
+            SET_ERROR();
+        }
+        DISPATCH();
+    }
+    TARGET(BOP_FSET_UNPACK)
+    {
+        tmp = ENTRY_OBJECT(STACK_TOP());
+        if (OBJ_TYPE(tmp) != TYPE_PAIR) {
+            SET_ERROR();
+        }
+        exec_frame_set_unpack(context, insp - 1, bc.arg, tmp);
+        if (act->errf) {
+            goto eval_end;
+        }
+        DISPATCH();
+    }
+    TARGET(BOP_POP)
+    {
+        tmp = STACK_POP();
+        ENTRY_RELEASE(tmp);
+        DISPATCH();
+    }
+    TARGET(BOP_RET)
+    {
+        /* the returned object may be borrowed from the frame */
+        if (stack->size > 0) {
+            ENTRY_OWN(STACK_TOP());
+        }
         frame_free(cur_frame);
-        dynarr_frameptr_pop(context.frame_stack);
+        dynarr_activation_pop(context.call_stack);
 #ifdef ENABLE_DEBUG_LOG
         if (global_is_enable_debug_log) {
             int caller_entry_index = context.tree->root_index;
-            if (context.frame_stack->size > 0) {
+            if (context.call_stack->size > 0) {
                 /* if not root */
                 frame_t* caller_frame
-                    = *dynarr_frameptr_back(context.frame_stack);
-                int* index_ptr = dynarr_int_back(&caller_frame->entry_indexs);
-                if (index_ptr) {
-                    caller_entry_index = *index_ptr;
+                    = dynarr_activation_back(context.call_stack)->frame;
+                if (caller_frame->entry_index != -1) {
+                    caller_entry_index = caller_frame->entry_index;
                 }
             }
             printf(
@@ -164,189 +493,251 @@ eval_bytecode(context_t context, bytecode_t bc)
             );
         }
 #endif
-        break;
-    case BOP_BF_OR_POP:
-        tmp = *dynarr_object_ptr_back(stack);
-        if (object_to_bool(tmp)) {
-            dynarr_object_ptr_pop(stack);
-            object_deref(tmp);
-            tmp = NULL;
+        if (context.call_stack->size == 0) {
+            goto eval_end;
+        }
+        LOAD_REGISTERS();
+        DISPATCH();
+    }
+    TARGET(BOP_BF_OR_POP)
+    {
+        tmp = STACK_TOP();
+        if (object_to_bool(ENTRY_OBJECT(tmp))) {
+            stack->size--;
+            ENTRY_RELEASE(tmp);
         } else {
-            regs->arg = regs->arg | bc.arg;
             /* already account for the +1 before exec */
-            regs->insp += regs->arg;
-        }
-        break;
-    case BOP_BT_OR_POP:
-        tmp = *dynarr_object_ptr_back(stack);
-        if (!object_to_bool(tmp)) {
-            dynarr_object_ptr_pop(stack);
-            object_deref(tmp);
-            tmp = NULL;
+            insp += bc.arg;
+        }
+        DISPATCH();
+    }
+    TARGET(BOP_BT_OR_POP)
+    {
+        tmp = STACK_TOP();
+        if (!object_to_bool(ENTRY_OBJECT(tmp))) {
+            stack->size--;
+            ENTRY_RELEASE(tmp);
         } else {
-            regs->arg = regs->arg | bc.arg;
             /* already account for the +1 before exec */
-            regs->insp += regs->arg;
-        }
-        break;
-    case BOP_MAKE_FUNCT:
-        regs->arg = regs->arg | bc.arg;
-        {
-            tmp = object_create(
-                TYPE_CALL,
-                (object_data_union)(callable_t) {
-                    .is_macro = 0,
-                    .builtin_name = NOT_BUILTIN_FUNC,
-                    .arg_subtree_index = -1,
-                    .index = regs->arg,
-                    /* function owns a deep copy of frame it created under */
-                    .init_frame = frame_copy(cur_frame),
-                }
-            );
+            insp += bc.arg;
         }
-        dynarr_object_ptr_append(stack, &tmp);
-        break;
-    case BOP_MAKE_MACRO:
-        regs->arg = regs->arg | bc.arg;
+        DISPATCH();
+    }
+    TARGET(BOP_MAKE_FUNCT)
+    {
+        tmp = object_create(
+            TYPE_CALL,
+            (object_data_union)(callable_t) {
+                .is_macro = 0,
+                .builtin_name = NOT_BUILTIN_FUNC,
+                .arg_subtree_index = -1,
+                .index = bc.arg,
+                /* function only keeps the identifiers it captures */
+                .init_frame = frame_capture(
+                    cur_frame, scope_of_entry(context.tree, bc.arg)
+                ),
+            }
+        );
+        STACK_PUSH(tmp);
+        DISPATCH();
+    }
+    TARGET(BOP_MAKE_MACRO)
+    {
         tmp = object_create(
             TYPE_CALL,
             (object_data_union)(callable_t) {
                 .is_macro = 1,
                 .builtin_name = NOT_BUILTIN_FUNC,
                 .arg_subtree_index = -1,
-                .index = regs->arg,
+                .index = bc.arg,
                 /* macro does not have frame */
                 .init_frame = NULL,
             }
         );
-        dynarr_object_ptr_append(stack, &tmp);
-        break;
-    case BOP_CALL:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_CALL, ANY_TYPE)) {
-            regs->errf = 1;
-            break;
-        }
-        exec_call(context, bc.pos, left, right);
-        /* check call depth */
-        if (context.frame_stack->size > 1000) {
-            print_runtime_error(bc.pos, "Call stack too deep (> 1000)");
-            regs->errf = 1;
+        STACK_PUSH(tmp);
+        DISPATCH();
+    }
+    TARGET(BOP_CALL)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_CALL, ANY_TYPE
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
+        /* check call depth. tail calls do not grow the call stack */
+        if (left->as.callable.builtin_name == NOT_BUILTIN_FUNC
+            && context.call_stack->size >= 1000 && !IS_TAIL_CALL()) {
+            RUNTIME_ERROR("Call stack too deep (> 1000)");
+        }
+        /* a tail call frees the frame that borrowed entries are from */
+        if (IS_TAIL_CALL()) {
+            ENTRY_OWN(left_entry);
+            ENTRY_OWN(right_entry);
+        }
+        SAVE_REGISTERS();
+        exec_call(context, insp - 1, left, right, IS_TAIL_CALL());
+        LOAD_REGISTERS();
         /* the stack was appended with returned object so no append needed */
-        object_deref(left);
-        object_deref(right);
-        break;
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        if (act->errf) {
+            goto eval_end;
+        }
+        DISPATCH();
+    }
 #if DEPRECATED
-    case BOP_MAP:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_CALL, TYPE_PAIR)) {
-            regs->errf = 1;
-            break;
-        }
-        tmp = exec_map(context, bc.pos, left, right);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_FILTER:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_CALL, TYPE_PAIR)) {
-            regs->errf = 1;
-            break;
-        }
-        tmp = exec_filter(context, bc.pos, left, right);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_REDUCE:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_CALL, TYPE_PAIR)) {
-            regs->errf = 1;
-            break;
-        }
-        tmp = exec_reduce(context, bc.pos, left, right);
-        object_deref(left);
-        object_deref(right);
-        break;
+    TARGET(BOP_MAP)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_CALL, TYPE_PAIR
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        SAVE_REGISTERS();
+        exec_map(context, insp - 1, left, right);
+        LOAD_REGISTERS();
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_FILTER)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_CALL, TYPE_PAIR
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        SAVE_REGISTERS();
+        exec_filter(context, insp - 1, left, right);
+        LOAD_REGISTERS();
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_REDUCE)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_CALL, TYPE_PAIR
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        SAVE_REGISTERS();
+        exec_reduce(context, insp - 1, left, right);
+        LOAD_REGISTERS();
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
 #endif
-    case BOP_NEG:
-        if (pop_l_check(stack, bc, &left, TYPE_NUM)) {
-            regs->errf = 1;
-            break;
+    TARGET(BOP_NEG)
+    {
+        if (pop_l_check(stack, bc, &left_entry, &left, TYPE_NUM)) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
-        tmp = object_create(
-            left->type, (object_data_union)number_neg(&left->as.number)
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        break;
-    case BOP_NOT:
-        if (pop_l_check(stack, bc, &left, ANY_TYPE)) {
-            regs->errf = 1;
-            break;
+        if (IS_SMALL_INT(left) && SMALL_INT_VALUE(left) != SMALL_INT_MIN) {
+            tmp = SMALL_INT_OBJECT(-SMALL_INT_VALUE(left));
+        } else if (IS_SMALL_INT(left)) {
+            tmp = object_from_number(number_from_i64(-(i64)SMALL_INT_MIN));
+        } else {
+            tmp = object_from_number(number_neg(&left->as.number));
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)(object_to_bool(left) ? ONE_NUMBER : ZERO_NUMBER)
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        break;
-    case BOP_CEIL:
-        if (pop_l_check(stack, bc, &left, TYPE_NUM)) {
-            regs->errf = 1;
-            break;
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_NOT)
+    {
+        if (pop_l_check(stack, bc, &left_entry, &left, ANY_TYPE)) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
-        tmp = object_create(
-            TYPE_NUM, (object_data_union)number_ceil(&left->as.number)
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        break;
-    case BOP_FLOOR:
-        if (pop_l_check(stack, bc, &left, TYPE_NUM)) {
-            regs->errf = 1;
-            break;
+        tmp = BOOL_OBJECT(object_to_bool(left));
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_CEIL)
+    {
+        if (pop_l_check(stack, bc, &left_entry, &left, TYPE_NUM)) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
-        tmp = object_create(
-            TYPE_NUM, (object_data_union)number_floor(&left->as.number)
+        /* integers are their own ceil */
+        tmp = IS_SMALL_INT(left)
+            ? left
+            : object_from_number(number_ceil(&left->as.number));
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_FLOOR)
+    {
+        if (pop_l_check(stack, bc, &left_entry, &left, TYPE_NUM)) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        /* integers are their own floor */
+        tmp = IS_SMALL_INT(left)
+            ? left
+            : object_from_number(number_floor(&left->as.number));
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_PGETL)
+    {
+        if (pop_l_check(stack, bc, &left_entry, &left, TYPE_PAIR)) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        /* the member lives as long as the pair */
+        tmp = IS_BORROWED(left_entry) ? BORROW(left->as.pair.left)
+                                      : object_ref(left->as.pair.left);
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_PGETR)
+    {
+        if (pop_l_check(stack, bc, &left_entry, &left, TYPE_PAIR)) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        /* the member lives as long as the pair */
+        tmp = IS_BORROWED(left_entry) ? BORROW(left->as.pair.right)
+                                      : object_ref(left->as.pair.right);
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_COND_CALL)
+    {
+        if (pop_l_check(stack, bc, &left_entry, &left, ANY_TYPE)) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        if (OBJ_TYPE(left) != TYPE_CALL) {
+            /* not callable: the object itself is the result */
+            STACK_PUSH(left_entry);
+            DISPATCH();
+        }
+        if (IS_TAIL_CALL()) {
+            ENTRY_OWN(left_entry);
+        }
+        SAVE_REGISTERS();
+        exec_call(
+            context, insp - 1, left,
+            (object_t*)&RESERVED_OBJS[RESERVED_ID_CODE_NULL], IS_TAIL_CALL()
         );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        break;
-    case BOP_PGETL:
-        if (pop_l_check(stack, bc, &left, TYPE_PAIR)) {
-            regs->errf = 1;
-            break;
-        }
-        tmp = object_ref(left->as.pair.left);
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        break;
-    case BOP_PGETR:
-        if (pop_l_check(stack, bc, &left, TYPE_PAIR)) {
-            regs->errf = 1;
-            break;
-        }
-        tmp = object_ref(left->as.pair.right);
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        break;
-    case BOP_COND_CALL:
-        if (pop_l_check(stack, bc, &left, ANY_TYPE)) {
-            regs->errf = 1;
-            break;
-        }
-        if (left->type == TYPE_CALL) {
-            exec_call(
-                context, bc.pos, left,
-                (object_t*)&RESERVED_OBJS[RESERVED_ID_CODE_NULL]
-            );
-            object_deref(left);
-        } else {
-            dynarr_object_ptr_append(stack, &tmp);
+        LOAD_REGISTERS();
+        ENTRY_RELEASE(left_entry);
+        if (act->errf) {
+            goto eval_end;
         }
-        break;
-    case BOP_SWAP:
-        if (pop_l_check(stack, bc, &left, TYPE_PAIR)) {
-            regs->errf = 1;
-            break;
+        DISPATCH();
+    }
+    TARGET(BOP_SWAP)
+    {
+        if (pop_l_check(stack, bc, &left_entry, &left, TYPE_PAIR)) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
         tmp = object_create(
             TYPE_PAIR,
@@ -355,211 +746,293 @@ eval_bytecode(context_t context, bytecode_t bc)
                 .right = object_ref(left->as.pair.left),
             }
         );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        break;
-    case BOP_EXP:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_NUM, TYPE_NUM)) {
-            regs->errf = 1;
-            break;
-        }
-        if (right->as.number.denom.size != 1
-            || right->as.number.denom.digit[0] != 1) {
-            print_runtime_error(bc.pos, "Exponent must be integer");
-            regs->errf = 1;
-            break;
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_EXP)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_NUM, TYPE_NUM
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)number_exp(&left->as.number, &right->as.number)
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_MUL:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_NUM, TYPE_NUM)) {
-            regs->errf = 1;
-            break;
+        if (!IS_SMALL_INT(right)
+            && (right->as.number.denom.size != 1
+                || right->as.number.denom.digit[0] != 1)) {
+            RUNTIME_ERROR("Exponent must be integer");
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)number_mul(&left->as.number, &right->as.number)
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_DIV:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_NUM, TYPE_NUM)) {
-            regs->errf = 1;
-            break;
-        }
-        if (right->as.number.numer.size == 0) {
-            print_runtime_error(bc.pos, "Divided by zero");
-            regs->errf = 1;
-            break;
+        tmp = number_binop(number_exp, left, right);
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_MUL)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_NUM, TYPE_NUM
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)number_div(&left->as.number, &right->as.number)
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_MOD:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_NUM, TYPE_NUM)) {
-            regs->errf = 1;
-            break;
+        if (BOTH_SMALL_INT(left, right)) {
+            intptr_t r;
+            if (!MUL_OVERFLOW(SMALL_INT_VALUE(left), SMALL_INT_VALUE(right), &r)
+                && IS_SMALL_INT_RANGE(r)) {
+                STACK_PUSH(SMALL_INT_OBJECT(r));
+                DISPATCH();
+            }
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)number_mod(&left->as.number, &right->as.number)
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_ADD:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_NUM, TYPE_NUM)) {
-            regs->errf = 1;
-            break;
+        /* write the result into the operand that is about to be freed */
+        if (IS_UNIQUE_NUMBER(left_entry)) {
+            tmp = number_binop_move(number_mul_move, left, right);
+            STACK_PUSH(tmp);
+            ENTRY_RELEASE(right_entry);
+            DISPATCH();
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)number_add(&left->as.number, &right->as.number)
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_SUB:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_NUM, TYPE_NUM)) {
-            regs->errf = 1;
-            break;
+        if (IS_UNIQUE_NUMBER(right_entry)) {
+            tmp = number_binop_move(number_mul_move, right, left);
+            STACK_PUSH(tmp);
+            ENTRY_RELEASE(left_entry);
+            DISPATCH();
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)number_sub(&left->as.number, &right->as.number)
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_LT:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_NUM, TYPE_NUM)) {
-            regs->errf = 1;
-            break;
+        tmp = number_binop(number_mul, left, right);
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_DIV)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_NUM, TYPE_NUM
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)
-                number_from_i32(number_lt(&left->as.number, &right->as.number))
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_LE:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_NUM, TYPE_NUM)) {
-            regs->errf = 1;
-            break;
+        if (right == SMALL_INT_OBJECT(0)
+            || (!IS_SMALL_INT(right) && right->as.number.numer.size == 0)) {
+            RUNTIME_ERROR("Divided by zero");
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)
-                number_from_i32(!number_lt(&right->as.number, &left->as.number))
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_GT:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_NUM, TYPE_NUM)) {
-            regs->errf = 1;
-            break;
+        /* exact quotient of small integers */
+        if (BOTH_SMALL_INT(left, right)) {
+            intptr_t l = SMALL_INT_VALUE(left), r = SMALL_INT_VALUE(right);
+            if (l % r == 0 && IS_SMALL_INT_RANGE(l / r)) {
+                STACK_PUSH(SMALL_INT_OBJECT(l / r));
+                DISPATCH();
+            }
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)
-                number_from_i32(number_lt(&right->as.number, &left->as.number))
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_GE:
-        if (pop_lr_check(stack, bc, &left, &right, TYPE_NUM, TYPE_NUM)) {
-            regs->errf = 1;
-            break;
+        tmp = number_binop(number_div, left, right);
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_MOD)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_NUM, TYPE_NUM
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)
-                number_from_i32(!number_lt(&left->as.number, &right->as.number))
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_EQ:
-        if (pop_lr_check(stack, bc, &left, &right, ANY_TYPE, ANY_TYPE)) {
-            regs->errf = 1;
-            break;
+        /* the sign rules of number_mod are kept by the slow path */
+        if (BOTH_SMALL_INT(left, right) && SMALL_INT_VALUE(left) >= 0
+            && SMALL_INT_VALUE(right) > 0) {
+            STACK_PUSH(
+                SMALL_INT_OBJECT(SMALL_INT_VALUE(left) % SMALL_INT_VALUE(right))
+            );
+            DISPATCH();
         }
-        tmp = object_create(
-            TYPE_NUM, (object_data_union)number_from_i32(object_eq(left, right))
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_NE:
-        if (pop_lr_check(stack, bc, &left, &right, ANY_TYPE, ANY_TYPE)) {
-            regs->errf = 1;
-            break;
+        tmp = number_binop(number_mod, left, right);
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_ADD)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_NUM, TYPE_NUM
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)number_from_i32(!object_eq(left, right))
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_AND:
-        if (pop_lr_check(stack, bc, &left, &right, ANY_TYPE, ANY_TYPE)) {
-            regs->errf = 1;
-            break;
+        if (BOTH_SMALL_INT(left, right)) {
+            intptr_t r = SMALL_INT_VALUE(left) + SMALL_INT_VALUE(right);
+            if (IS_SMALL_INT_RANGE(r)) {
+                STACK_PUSH(SMALL_INT_OBJECT(r));
+                DISPATCH();
+            }
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)
-                number_from_i32(object_to_bool(left) && object_to_bool(right))
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_OR:
-        if (pop_lr_check(stack, bc, &left, &right, ANY_TYPE, ANY_TYPE)) {
-            regs->errf = 1;
-            break;
+        /* write the result into the operand that is about to be freed */
+        if (IS_UNIQUE_NUMBER(left_entry)) {
+            tmp = number_binop_move(number_add_move, left, right);
+            STACK_PUSH(tmp);
+            ENTRY_RELEASE(right_entry);
+            DISPATCH();
         }
-        tmp = object_create(
-            TYPE_NUM,
-            (object_data_union)
-                number_from_i32(object_to_bool(left) || object_to_bool(right))
-        );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_PAIR:
-        if (pop_lr_check(stack, bc, &left, &right, ANY_TYPE, ANY_TYPE)) {
-            regs->errf = 1;
-            break;
+        if (IS_UNIQUE_NUMBER(right_entry)) {
+            tmp = number_binop_move(number_add_move, right, left);
+            STACK_PUSH(tmp);
+            ENTRY_RELEASE(left_entry);
+            DISPATCH();
+        }
+        tmp = number_binop(number_add, left, right);
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_SUB)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_NUM, TYPE_NUM
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        if (BOTH_SMALL_INT(left, right)) {
+            intptr_t r = SMALL_INT_VALUE(left) - SMALL_INT_VALUE(right);
+            if (IS_SMALL_INT_RANGE(r)) {
+                STACK_PUSH(SMALL_INT_OBJECT(r));
+                DISPATCH();
+            }
+        }
+        /* write the result into the operand that is about to be freed */
+        if (IS_UNIQUE_NUMBER(left_entry)) {
+            tmp = number_binop_move(number_sub_move, left, right);
+            STACK_PUSH(tmp);
+            ENTRY_RELEASE(right_entry);
+            DISPATCH();
+        }
+        tmp = number_binop(number_sub, left, right);
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_LT)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_NUM, TYPE_NUM
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        tmp = BOOL_OBJECT(number_object_lt(left, right));
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_LE)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_NUM, TYPE_NUM
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        tmp = BOOL_OBJECT(!number_object_lt(right, left));
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_GT)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_NUM, TYPE_NUM
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        tmp = BOOL_OBJECT(number_object_lt(right, left));
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_GE)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                TYPE_NUM, TYPE_NUM
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        tmp = BOOL_OBJECT(!number_object_lt(left, right));
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_EQ)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                ANY_TYPE, ANY_TYPE
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        tmp = BOOL_OBJECT(object_eq(left, right));
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_NE)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                ANY_TYPE, ANY_TYPE
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        tmp = BOOL_OBJECT(!object_eq(left, right));
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_AND)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                ANY_TYPE, ANY_TYPE
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        tmp = BOOL_OBJECT(object_to_bool(left) && object_to_bool(right));
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_OR)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                ANY_TYPE, ANY_TYPE
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
+        }
+        tmp = BOOL_OBJECT(object_to_bool(left) || object_to_bool(right));
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_PAIR)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                ANY_TYPE, ANY_TYPE
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
         tmp = object_create(
             TYPE_PAIR,
@@ -568,180 +1041,145 @@ eval_bytecode(context_t context, bytecode_t bc)
                 .right = object_ref(right),
             }
         );
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_BIND_ARG:
-        tmp = *dynarr_object_ptr_back(stack);
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_BIND_ARG)
+    {
+        tmp = ENTRY_OBJECT(STACK_TOP());
         if (is_bad_type(bc, NO_OPERAND, TYPE_CALL, NULL, tmp)) {
-            regs->errf = 1;
-            break;
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
         if (tmp->as.callable.is_macro) {
             const char* err_msg
                 = "Right side of argument binder should be function";
-            print_runtime_error(bc.pos, err_msg);
-            regs->errf = 1;
-            break;
+            RUNTIME_ERROR(err_msg);
         }
         if (tmp->as.callable.arg_subtree_index != -1) {
             const char* err_msg
                 = "Bind argument to a function that already has one";
-            print_runtime_error(bc.pos, err_msg);
-            regs->errf = 1;
-            break;
-        }
-        regs->arg = regs->arg | bc.arg;
-        tmp->as.callable.arg_subtree_index = regs->arg;
-        break;
-    case BOP_COND_PGET:
-        if (pop_lr_check(stack, bc, &left, &right, ANY_TYPE, TYPE_PAIR)) {
-            regs->errf = 1;
-            break;
+            RUNTIME_ERROR(err_msg);
+        }
+        tmp->as.callable.arg_subtree_index = bc.arg;
+        DISPATCH();
+    }
+    TARGET(BOP_COND_PGET)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                ANY_TYPE, TYPE_PAIR
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
         /* check inside the pair */
         tmp = object_to_bool(left) ? right->as.pair.left : right->as.pair.right;
-        dynarr_object_ptr_append(stack, &tmp);
-        object_deref(left);
-        object_deref(right);
-        break;
-    case BOP_COND_PCALL:
-        if (pop_lr_check(stack, bc, &left, &right, ANY_TYPE, TYPE_PAIR)) {
-            regs->errf = 1;
-            break;
+        tmp = IS_BORROWED(right_entry) ? BORROW(tmp) : object_ref(tmp);
+        STACK_PUSH(tmp);
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        DISPATCH();
+    }
+    TARGET(BOP_COND_PCALL)
+    {
+        if (pop_lr_check(
+                stack, bc, &left_entry, &right_entry, &left, &right,
+                ANY_TYPE, TYPE_PAIR
+            )) {
+            RUNTIME_ERROR(ERR_MSG_BUF);
         }
         /* check inside the pair */
-        {
-            object_t* res_object = object_to_bool(left) ? right->as.pair.left
-                                                        : right->as.pair.right;
-            if (res_object->type == TYPE_CALL) {
-                exec_call(
-                    context, bc.pos, res_object,
-                    (object_t*)&RESERVED_OBJS[RESERVED_ID_CODE_NULL]
-                );
-            } else {
-                object_ref(res_object);
-                dynarr_object_ptr_append(stack, &res_object);
+        tmp = object_to_bool(left) ? right->as.pair.left : right->as.pair.right;
+        if (OBJ_TYPE(tmp) == TYPE_CALL) {
+            if (IS_TAIL_CALL()) {
+                ENTRY_OWN(right_entry);
             }
+            SAVE_REGISTERS();
+            exec_call(
+                context, insp - 1, tmp,
+                (object_t*)&RESERVED_OBJS[RESERVED_ID_CODE_NULL],
+                IS_TAIL_CALL()
+            );
+            LOAD_REGISTERS();
+        } else {
+            tmp = IS_BORROWED(right_entry) ? BORROW(tmp) : object_ref(tmp);
+            STACK_PUSH(tmp);
         }
-        object_deref(left);
-        object_deref(right);
-        break;
-    default:
-        sprintf(
-            ERR_MSG_BUF, "eval_bytecode: bad bytecode: %d,%d\n", bc.op, bc.arg
-        );
-        print_runtime_error(bc.pos, ERR_MSG_BUF);
-        exit(RUNTIME_ERR_CODE);
-    }
-    /* re-getting the back because there can be a call */
-    regs = dynarr_registers_back(context.regs_stack);
-    if (regs && tmp && tmp->is_error) {
-        regs->errf = 1;
-    }
-    if (regs && bc.op != BOP_EXTEND_ARG) {
-        regs->arg = 0;
+        ENTRY_RELEASE(left_entry);
+        ENTRY_RELEASE(right_entry);
+        if (act->errf) {
+            goto eval_end;
+        }
+        DISPATCH();
     }
-    return regs;
-}
 
-void
-eval(context_t context)
-{
-    const syntax_tree_t* tree = context.tree;
-    /* begin evaluation */
-    while (1) {
-        registers_t* cur_regs = dynarr_registers_back(context.regs_stack);
-        bytecode_t bc = tree->bytecodes.data[cur_regs->insp];
-
-#ifdef ENABLE_DEBUG_LOG
-        if (global_is_enable_debug_log) {
-            int i;
-            printf(
-                "inst=%d, arg=%u, object_stack=[", cur_regs->insp, cur_regs->arg
-            );
-            for (i = 0; i < context.object_stack->size; i++) {
-                object_print(context.object_stack->data[i], ',');
-                printf(" ");
-            }
-            printf("]\n");
-            printf("exec bytecode: ");
-            bytecode_print(bc);
-            printf("\n");
+#ifndef USE_COMPUTED_GOTO
+        default:
+            goto bad_bytecode;
         }
+    }
 #endif
 
-        cur_regs = eval_bytecode(context, bc);
+bad_bytecode:
+    sprintf(ERR_MSG_BUF, "eval: bad bytecode: %d,%d\n", bc.op, bc.arg);
+    print_runtime_error(BYTECODE_POS(), ERR_MSG_BUF);
+    exit(RUNTIME_ERR_CODE);
 
-        if (cur_regs == NULL || context.regs_stack->size == 0) {
+eval_end:
 #ifdef ENABLE_DEBUG_LOG
-            if (global_is_enable_debug_log) {
-                printf("eval returned ");
-                object_print(
-                    *dynarr_object_ptr_back(context.object_stack), '\n'
-                );
-                fflush(stdout);
-            }
-#endif
-            break;
-        }
-
-        if (cur_regs->errf) {
-#ifdef ENABLE_DEBUG_LOG
-            if (global_is_enable_debug_log) {
-                printf("early end because intermediate result is error\n");
-            }
-#endif
-            break;
+    if (global_is_enable_debug_log) {
+        if (context.call_stack->size == 0) {
+            printf("eval returned ");
+            object_print(
+                ENTRY_OBJECT(*dynarr_object_ptr_back(context.object_stack)),
+                '\n'
+            );
+            fflush(stdout);
+        } else {
+            printf("early end because intermediate result is error\n");
         }
     }
+#endif
+    return;
 }
 
 void
 eval_root(const syntax_tree_t* syntax_tree)
 {
-    frame_t* root_frame = frame_new(NULL);
-    dynarr_frameptr_t frame_stack = dynarr_frameptr_new();
-
-    registers_t regs = {
-        .arg = 0,
+    activation_t root_activation = {
         .insp = syntax_tree_get_bytecode_start_index(
             syntax_tree, syntax_tree->root_index
         ),
         .errf = 0,
+        .frame = frame_new(syntax_tree->max_id_code),
     };
-    dynarr_registers_t regs_stack = dynarr_registers_new();
+    dynarr_activation_t call_stack = dynarr_activation_new();
 
     dynarr_object_ptr_t object_stack = dynarr_object_ptr_new();
 
     context_t root_context = {
         .tree = syntax_tree,
-        .frame_stack = &frame_stack,
-        .regs_stack = &regs_stack,
+        .call_stack = &call_stack,
         .object_stack = &object_stack,
     };
-    object_t* final_result = NULL;
+    int i;
 
-    dynarr_registers_append(&regs_stack, &regs);
-    dynarr_frameptr_append(&frame_stack, &root_frame);
+    dynarr_activation_append(&call_stack, &root_activation);
+    dynarr_object_ptr_reserve(
+        &object_stack, syntax_tree->max_stack_sizes[syntax_tree->root_index]
+    );
 
     eval(root_context);
 
-    final_result = *dynarr_object_ptr_back(&object_stack);
-    if (final_result == NULL || final_result->is_error) {
-        int i;
-        /* clear stack because it may not be cleared if not properly
-         * returned */
-        for (i = 0; i < object_stack.size; i++) {
-            object_deref(object_stack.data[i]);
-        }
+    /* the final result is the only object left in the stack if evaluation
+     * returned properly, otherwise clear all remaining objects */
+    for (i = 0; i < object_stack.size; i++) {
+        ENTRY_RELEASE(object_stack.data[i]);
     }
-    object_deref(final_result);
     dynarr_object_ptr_free(&object_stack);
+    object_wait_background_free();
 
-    dynarr_registers_free(&regs_stack);
     /* don't need to free frame because callee free it in RET */
-    /* frame_free(root_frame); */
-    dynarr_frameptr_free(&frame_stack);
+    dynarr_activation_free(&call_stack);
 }
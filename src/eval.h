@@ -6,22 +6,24 @@
 #ifndef EVAL_H
 #define EVAL_H
 
-typedef struct registers {
-    uint32_t arg; /* extendable argument */
+/* the activation record of a running callable */
+typedef struct activation {
     uint32_t insp; /* instruction pointer */
     uint16_t errf; /* error flag */
-} registers_t;
+    frame_t* frame; /* the frame the callable runs in */
+} activation_t;
 
-#define TYPE registers_t
-#define TYPE_NAME registers
+#define TYPE activation_t
+#define TYPE_NAME activation
 #include "utils/dynarr.tmpl.h"
 #undef TYPE_NAME
 #undef TYPE
 
 typedef struct context {
     const syntax_tree_t* tree;
-    dynarr_frameptr_t* frame_stack;
-    dynarr_registers_t* regs_stack;
+    dynarr_activation_t* call_stack;
+    /* the operands of all activations. a call reserves the maximum stack
+     * size of the callee so pushing does not need to check the capacity */
     dynarr_object_ptr_t* object_stack;
 } context_t;
 
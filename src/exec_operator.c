@@ -4,30 +4,63 @@
 #include "frame.h"
 #include "utils/global_flags.h"
 
+/* the position is looked up from the line table only when there is error */
+static inline void
+print_bytecode_error(
+    const context_t context, const int bytecode_index, const char* msg
+)
+{
+    print_runtime_error(
+        syntax_tree_get_bytecode_pos(context.tree, bytecode_index), msg
+    );
+}
+
+/* set the object to the identifier node by its resolved address */
+static inline object_t**
+set_id(
+    const syntax_tree_t* tree, frame_t* frame, const int index, object_t* obj
+)
+{
+    const uint32_t addr = tree->id_addrs[index];
+    if (addr == GLOBAL_ADDR) {
+        return frame_set_global(frame, tree->tokens.data[index].code, obj);
+    } else if (addr == NAME_ADDR) {
+        return frame_set(frame, tree->tokens.data[index].code, obj);
+    }
+    return frame_set_local(frame, addr, obj);
+}
+
 void
-exec_call(context_t context, linecol_t pos, const object_t* call, object_t* arg)
+exec_call(
+    context_t context, const int bytecode_index, const object_t* call,
+    object_t* arg, const int is_tail_call
+)
 {
     object_t* result;
-    frame_t* caller_frame = *dynarr_frameptr_back(context.frame_stack);
+    activation_t* caller = dynarr_activation_back(context.call_stack);
+    frame_t* caller_frame = caller->frame;
     frame_t* callee_frame;
+    const scope_t* callee_scope = NULL;
     callable_t callable = call->as.callable;
-    registers_t new_registers = { .arg = 0, .insp = 0, .errf = 0 };
+    activation_t callee = { .insp = 0, .errf = 0, .frame = NULL };
 
     /* if is builtin */
     if (callable.builtin_name != -1) {
         object_t* (*func_ptr)(const object_t*)
             = BUILDTIN_FUNC_ARRAY[callable.builtin_name];
         if (func_ptr == NULL) {
-            print_runtime_error(pos, "Currupted builtin function\n");
-            dynarr_registers_back(context.regs_stack)->errf = 1;
+            print_bytecode_error(
+                context, bytecode_index, "Currupted builtin function\n"
+            );
+            dynarr_activation_back(context.call_stack)->errf = 1;
             return;
         }
 
         ERR_MSG_BUF[0] = '\0';
         result = func_ptr(arg);
-        if (result->is_error && ERR_MSG_BUF[0] != '\0') {
-            print_runtime_error(pos, ERR_MSG_BUF);
-            dynarr_registers_back(context.regs_stack)->errf = 1;
+        if (OBJ_IS_ERROR(result) && ERR_MSG_BUF[0] != '\0') {
+            print_bytecode_error(context, bytecode_index, ERR_MSG_BUF);
+            dynarr_activation_back(context.call_stack)->errf = 1;
         } else {
             dynarr_object_ptr_append(context.object_stack, &result);
         }
@@ -40,19 +73,38 @@ exec_call(context_t context, linecol_t pos, const object_t* call, object_t* arg)
     }
 #endif
 
-    /* get callee frame */
-    callee_frame = callable.is_macro
-        ? frame_ref(caller_frame)
-        : frame_get_callee_frame(caller_frame, call);
-
-    /* push callee frame to context */
-    dynarr_frameptr_append(context.frame_stack, &callee_frame);
+    if (!callable.is_macro) {
+        callee_scope = scope_of_entry(context.tree, callable.index);
+    }
 
-    /* get callable's starting index */
-    new_registers.insp
+    /* get callable's starting index and reserve its operand stack */
+    callee.insp
         = syntax_tree_get_bytecode_start_index(context.tree, callable.index);
-    /* push new register to context */
-    dynarr_registers_append(context.regs_stack, &new_registers);
+    dynarr_object_ptr_reserve(
+        context.object_stack, context.tree->max_stack_sizes[callable.index]
+    );
+
+    if (is_tail_call) {
+        /* the callee replaces the caller's activation */
+        if (!callable.is_macro) {
+            callee_frame = frame_get_tail_callee_frame(
+                caller_frame, call, callee_scope
+            );
+        } else {
+            /* macro runs in the caller frame, so just keep it */
+            callee_frame = caller_frame;
+        }
+        callee.frame = callee_frame;
+        *caller = callee;
+    } else {
+        /* get callee frame */
+        callee_frame = callable.is_macro
+            ? frame_ref(caller_frame)
+            : frame_get_callee_frame(call, callee_scope);
+        /* push the callee's activation to context */
+        callee.frame = callee_frame;
+        dynarr_activation_append(context.call_stack, &callee);
+    }
 
 #ifdef ENABLE_DEBUG_LOG
     if (global_is_enable_debug_log) {
@@ -70,26 +122,29 @@ exec_call(context_t context, linecol_t pos, const object_t* call, object_t* arg)
         int arg_subtree_index = callable.arg_subtree_index;
         token_t arg_token = context.tree->tokens.data[arg_subtree_index];
         if (arg_token.type == TOK_ID) {
-            /* if token at arg index is identifier, do normal frame_set */
-            if (frame_set(callee_frame, arg_token.code, arg) == NULL) {
+            /* if token at arg index is identifier, set it to its slot */
+            if (set_id(context.tree, callee_frame, arg_subtree_index, arg)
+                == NULL) {
                 sprintf(
                     ERR_MSG_BUF, "Failed initialization of argument '%s'",
                     arg_token.str
                 );
-                print_runtime_error(pos, ERR_MSG_BUF);
-                dynarr_registers_back(context.regs_stack)->errf = 1;
+                print_bytecode_error(context, bytecode_index, ERR_MSG_BUF);
+                dynarr_activation_back(context.call_stack)->errf = 1;
             }
         } else {
             /* if token at arg index is pair op, do frame set from pair */
-            if (arg->type != TYPE_PAIR) {
-                print_runtime_error(
-                    pos,
+            if (OBJ_TYPE(arg) != TYPE_PAIR) {
+                print_bytecode_error(
+                    context, bytecode_index,
                     "Failed initialization of argument: Cannot unpack "
                     "non-pair object"
                 );
-                dynarr_registers_back(context.regs_stack)->errf = 1;
+                dynarr_activation_back(context.call_stack)->errf = 1;
             } else {
-                exec_frame_set_unpack(context, pos, arg_subtree_index, arg);
+                exec_frame_set_unpack(
+                    context, bytecode_index, arg_subtree_index, arg
+                );
             }
         }
     }
@@ -98,7 +153,7 @@ exec_call(context_t context, linecol_t pos, const object_t* call, object_t* arg)
     if (global_is_enable_debug_log) {
         printf(
             "exec_call: final state: entry_index=%d\n stack_depth=%d\n",
-            callable.index, context.frame_stack->size
+            callable.index, context.call_stack->size
         );
     }
 #endif
@@ -106,53 +161,65 @@ exec_call(context_t context, linecol_t pos, const object_t* call, object_t* arg)
 
 void
 exec_frame_set_unpack(
-    context_t context, linecol_t pos, const int assignee_index,
+    context_t context, const int bytecode_index, const int assignee_index,
     const object_t* pair
 )
 {
-    frame_t* cur_frame = *dynarr_frameptr_back(context.frame_stack);
+    frame_t* cur_frame = dynarr_activation_back(context.call_stack)->frame;
     const syntax_tree_t* tree = context.tree;
     const token_t left_token = tree->tokens.data[tree->lefts[assignee_index]];
     const token_t right_token = tree->tokens.data[tree->rights[assignee_index]];
     if (left_token.type == TOK_ID) {
-        if (!frame_set(cur_frame, left_token.code, pair->as.pair.left)) {
+        if (!set_id(
+                tree, cur_frame, tree->lefts[assignee_index],
+                pair->as.pair.left
+            )) {
             const char* err_msg = "Repeated initialization of identifier '%s'";
             sprintf(
                 ERR_MSG_BUF, err_msg,
                 context.tree->id_code_str_map[left_token.code]
             );
-            print_runtime_error(pos, ERR_MSG_BUF);
-            dynarr_registers_back(context.regs_stack)->errf = 1;
+            print_bytecode_error(context, bytecode_index, ERR_MSG_BUF);
+            dynarr_activation_back(context.call_stack)->errf = 1;
         };
     } else {
         /* else: it can only be a pair */
-        if (pair->as.pair.left->type != TYPE_PAIR) {
-            print_runtime_error(pos, "Cannot unpack non-pair object");
-            dynarr_registers_back(context.regs_stack)->errf = 1;
+        if (OBJ_TYPE(pair->as.pair.left) != TYPE_PAIR) {
+            print_bytecode_error(
+                context, bytecode_index, "Cannot unpack non-pair object"
+            );
+            dynarr_activation_back(context.call_stack)->errf = 1;
         } else {
             exec_frame_set_unpack(
-                context, pos, tree->lefts[assignee_index], pair->as.pair.left
+                context, bytecode_index, tree->lefts[assignee_index],
+                pair->as.pair.left
             );
         }
     }
     if (right_token.type == TOK_ID) {
-        if (!frame_set(cur_frame, right_token.code, pair->as.pair.right)) {
+        if (!set_id(
+                tree, cur_frame, tree->rights[assignee_index],
+                pair->as.pair.right
+            )) {
             const char* err_msg = "Repeated initialization of identifier '%s'";
             sprintf(
                 ERR_MSG_BUF, err_msg,
                 context.tree->id_code_str_map[right_token.code]
             );
-            print_runtime_error(pos, ERR_MSG_BUF);
-            dynarr_registers_back(context.regs_stack)->errf = 1;
+            print_bytecode_error(context, bytecode_index, ERR_MSG_BUF);
+            dynarr_activation_back(context.call_stack)->errf = 1;
         };
     } else {
         /* else: it can only be a pair */
-        if (pair->as.pair.right->type != TYPE_PAIR) {
-            print_runtime_error(pos, "Cannot unpack non-pair object");
-            dynarr_registers_back(context.regs_stack)->errf = 1;
+        if (OBJ_TYPE(pair->as.pair.right) != TYPE_PAIR) {
+            print_bytecode_error(
+                context, bytecode_index, "Cannot unpack non-pair object"
+            );
+            dynarr_activation_back(context.call_stack)->errf = 1;
         } else {
             exec_frame_set_unpack(
-                context, pos, tree->rights[assignee_index], pair->as.pair.right
+                context, bytecode_index, tree->rights[assignee_index],
+                pair->as.pair.right
             );
         }
     }
@@ -172,8 +239,8 @@ enum pair_traverse_code_enum {
 
 int
 map_process_node(
-    context_t context, linecol_t pos, const object_t* call, object_t* arg,
-    object_t** res
+    context_t context, const int bytecode_index, const object_t* call,
+    object_t* arg, object_t** res
 )
 {
     if (arg->type == TYPE_PAIR) {
@@ -187,7 +254,7 @@ map_process_node(
         return VISITED_PAIR;
     }
     if (*res == NULL) {
-        object_t* result = exec_call(context, pos, call, arg);
+        object_t* result = exec_call(context, bytecode_index, call, arg, 0);
         if (result->is_error) {
 #ifdef ENABLE_DEBUG_LOG
             if (global_is_enable_debug_log) {
@@ -206,7 +273,10 @@ map_process_node(
 
 /* apply callable recursively in postfix order and return a new pair */
 object_t*
-exec_map(context_t context, linecol_t pos, const object_t* call, object_t* pair)
+exec_map(
+    context_t context, const int bytecode_index, const object_t* call,
+    object_t* pair
+)
 {
 #ifdef ENABLE_DEBUG_LOG
     if (global_is_enable_debug_log) {
@@ -248,7 +318,9 @@ exec_map(context_t context, linecol_t pos, const object_t* call, object_t* pair)
         }
         /* left */
         process_result_enum
-            = map_process_node(context, pos, call, arg_left, res_left);
+            = map_process_node(
+                context, bytecode_index, call, arg_left, res_left
+            );
         if (process_result_enum == ERROR) {
 #ifdef ENABLE_DEBUG_LOG
             if (global_is_enable_debug_log) {
@@ -265,7 +337,9 @@ exec_map(context_t context, linecol_t pos, const object_t* call, object_t* pair)
         }
         /* right */
         process_result_enum
-            = map_process_node(context, pos, call, arg_right, res_right);
+            = map_process_node(
+                context, bytecode_index, call, arg_right, res_right
+            );
         if (process_result_enum == ERROR) {
 #ifdef ENABLE_DEBUG_LOG
             if (global_is_enable_debug_log) {
@@ -344,8 +418,8 @@ filter_merge(object_t* pair_to_merge)
 
 int
 filter_process_node(
-    context_t context, linecol_t pos, const object_t* func, object_t* arg,
-    object_t** res
+    context_t context, const int bytecode_index, const object_t* func,
+    object_t* arg, object_t** res
 )
 {
     if (arg->type == TYPE_PAIR) {
@@ -359,7 +433,7 @@ filter_process_node(
         return VISITED_PAIR;
     }
     if (*res == NULL) {
-        object_t* result = exec_call(context, pos, func, arg);
+        object_t* result = exec_call(context, bytecode_index, func, arg, 0);
         if (result->is_error) {
             object_deref(result);
             return ERROR;
@@ -383,7 +457,8 @@ filter_process_node(
    becomes NULL as well. */
 object_t*
 exec_filter(
-    context_t context, linecol_t pos, const object_t* call, object_t* pair
+    context_t context, const int bytecode_index, const object_t* call,
+    object_t* pair
 )
 {
 #ifdef ENABLE_DEBUG_LOG
@@ -429,7 +504,9 @@ exec_filter(
         }
         /* left */
         process_result_enum
-            = filter_process_node(context, pos, call, arg_left, res_left);
+            = filter_process_node(
+                context, bytecode_index, call, arg_left, res_left
+            );
         if (process_result_enum == ERROR) {
 #ifdef ENABLE_DEBUG_LOG
             if (global_is_enable_debug_log) {
@@ -446,7 +523,9 @@ exec_filter(
         }
         /* right */
         process_result_enum
-            = filter_process_node(context, pos, call, arg_right, res_right);
+            = filter_process_node(
+                context, bytecode_index, call, arg_right, res_right
+            );
         if (process_result_enum == ERROR) {
 #ifdef ENABLE_DEBUG_LOG
             if (global_is_enable_debug_log) {
@@ -610,7 +689,7 @@ exec_reduce(
         }
         /* reduce */
         object_t* reduce_result
-            = exec_call(context, token_pos, call, *res_pair_ptr);
+            = exec_call(context, token_pos, call, *res_pair_ptr, 0);
         if (reduce_result->is_error) {
 #ifdef ENABLE_DEBUG_LOG
             if (global_is_enable_debug_log) {
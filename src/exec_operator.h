@@ -1,26 +1,30 @@
 #include "eval.h"
 
 extern void exec_call(
-    context_t context, linecol_t pos, const object_t* call, object_t* arg
+    context_t context, const int bytecode_index, const object_t* call,
+    object_t* arg, const int is_tail_call
 );
 
 extern void exec_frame_set_unpack(
-    context_t context, linecol_t pos, const int assignee_index,
+    context_t context, const int bytecode_index, const int assignee_index,
     const object_t* pair
 );
 
 #if DEPRECATED
 
     extern void exec_map(
-        context_t context, linecol_t pos, const object_t* call, object_t* pair
+        context_t context, const int bytecode_index, const object_t* call,
+        object_t* pair
     );
 
 extern void exec_filter(
-    context_t context, linecol_t pos, const object_t* call, object_t* pair
+    context_t context, const int bytecode_index, const object_t* call,
+    object_t* pair
 );
 
 extern void exec_reduce(
-    context_t context, linecol_t pos, const object_t* call, object_t* pair
+    context_t context, const int bytecode_index, const object_t* call,
+    object_t* pair
 );
 
 #endif
@@ -12,50 +12,134 @@
 
 #define PTR_L20BITS(p) ((void*)(((uintptr_t)p) & 0xfffff))
 
+static inline void
+hole_deref(hole_t* h)
+{
+    h->ref_count--;
+    if (h->ref_count == 0) {
+        if (h->object != NULL) {
+            object_deref(h->object);
+        }
+        free(h);
+    }
+}
+
+/* increase ref count of the object and hole of entry */
+static inline void
+entry_ref(frame_entry_t* entry)
+{
+    if (entry->object != NULL) {
+        object_ref(entry->object);
+    }
+    if (entry->hole != NULL) {
+        entry->hole->ref_count++;
+    }
+}
+
+/* decrease ref count of the object and hole of entry */
+static inline void
+entry_deref(frame_entry_t* entry)
+{
+    if (entry->object != NULL) {
+        object_deref(entry->object);
+    }
+    if (entry->hole != NULL) {
+        hole_deref(entry->hole);
+    }
+}
+
+/* is the object only kept alive by the slot and, through its own init-time
+ * frame, by the hole of the slot. a local function that calls itself is like
+ * this if it does not outlive the frame. moving it into the hole would keep
+ * it alive forever */
+static int
+is_held_by_own_hole(const object_t* obj, const hole_t* h)
+{
+    int i, count = 0;
+    const frame_t* init_frame;
+    if (obj == NULL || OBJ_TYPE(obj) != TYPE_CALL || obj->ref_count != 1) {
+        return 0;
+    }
+    init_frame = obj->as.callable.init_frame;
+    if (init_frame == NULL || init_frame->ref_count != 1) {
+        return 0;
+    }
+    for (i = 0; i < init_frame->stack.size; i++) {
+        if (init_frame->stack.data[i].hole == h) {
+            count++;
+        }
+    }
+    /* the other reference is held by the frame of the slot */
+    return count == h->ref_count - 1;
+}
+
+/* create a root frame that owns the globals of the identifiers whose code is
+ * not greater than max_id_code */
 inline frame_t*
-frame_new(const frame_t* parent)
+frame_new(const int max_id_code)
 {
     frame_t* f = malloc(sizeof(frame_t));
     assert(f != NULL);
     *f = (frame_t) {
         .ref_count = 1,
-        .globals = NULL,
-        .is_own_globals = 0,
-        .entry_indexs = dynarr_int_new(),
-        .stack_pointers = dynarr_int_new(),
+        .globals = calloc(max_id_code + 1, sizeof(object_t*)),
+        .globals_size = max_id_code + 1,
+        .is_own_globals = 1,
+        .entry_index = -1,
+        .parent = NULL,
         .stack = dynarr_frame_entry_new(),
+        .holes = NULL,
     };
-    if (parent == NULL) {
-        /* allocate a globals ourself */
-        f->globals = calloc(1, sizeof(dynarr_int_t));
-        assert(f->globals != NULL);
-        *(f->globals) = dynarr_frame_entry_new();
-        f->is_own_globals = 1;
-    } else {
-        /* copy the globals from parent */
-        f->globals = parent->globals;
-    }
+    assert(f->globals != NULL);
     return f;
 }
 
-/* deep copy a frame and increase ref count of all objects in stack */
-inline frame_t*
-frame_copy(const frame_t* f)
+/* The frames of the functions that do not create closures are never read
+ * after they return, so they are allocated in a stack in call order and
+ * popped when freed. */
+static arena_t activation_stack = { 0, 0, NULL };
+
+#define ACTIVATION_STACK_CAP (1 << 20)
+
+#define IS_IN_ACTIVATION_STACK(f)                                              \
+    ((void*)(f) >= activation_stack.ptr                                        \
+     && (void*)(f) < activation_stack.ptr + activation_stack.cap)
+
+/* create a frame whose stack is allocated along with it and has a fixed size
+ * of uninitialized entries. if is_on_stack is true and there is enough space,
+ * it is allocated in the activation stack */
+static frame_t*
+frame_new_fixed(
+    const frame_t* globals_frame, const int size, const int is_on_stack
+)
 {
-    int i;
-    frame_t* clone_frame = malloc(sizeof(frame_t));
-    clone_frame->ref_count = 1;
-    clone_frame->globals = f->globals;
-    clone_frame->is_own_globals = 0;
-    /* copy the entry_indexs and stack pointers */
-    clone_frame->entry_indexs = dynarr_int_copy(&f->entry_indexs);
-    clone_frame->stack_pointers = dynarr_int_copy(&f->stack_pointers);
-    /* deep copy stack */
-    clone_frame->stack = dynarr_frame_entry_copy(&f->stack);
-    for (i = 0; i < f->stack.size; i++) {
-        object_ref(dynarr_frame_entry_at(&clone_frame->stack, i)->object);
+    frame_t* f;
+    unsigned long alloc_size = sizeof(frame_t) + size * sizeof(frame_entry_t);
+    if (is_on_stack && activation_stack.ptr == NULL) {
+        arena_init(&activation_stack, ACTIVATION_STACK_CAP);
+    }
+    if (is_on_stack
+        && activation_stack.size + alloc_size < activation_stack.cap) {
+        f = arena_malloc(&activation_stack, alloc_size);
+    } else {
+        f = malloc(alloc_size);
     }
-    return clone_frame;
+    assert(f != NULL);
+    *f = (frame_t) {
+        .ref_count = 1,
+        .globals = globals_frame->globals,
+        .globals_size = globals_frame->globals_size,
+        .is_own_globals = 0,
+        .entry_index = -1,
+        .parent = NULL,
+        .stack = {
+            .size = size,
+            .cap = size,
+            .data = (frame_entry_t*)(f + 1),
+        },
+        .holes = NULL,
+    };
+    return f;
 }
 
 inline frame_t*
@@ -70,6 +154,7 @@ inline void
 frame_free(frame_t* f)
 {
     int i;
+    frame_t* parent;
 #ifdef ENABLE_DEBUG_LOG_MORE
     printf("frame_free: %p\n", f);
 #endif
@@ -79,107 +164,207 @@ frame_free(frame_t* f)
         return;
     }
     if (f->is_own_globals && f->globals) {
-        for (i = 0; i < f->globals->size; i++) {
-            object_deref(dynarr_frame_entry_at(f->globals, i)->object);
+        for (i = 0; i < f->globals_size; i++) {
+            if (f->globals[i] != NULL) {
+                object_deref(f->globals[i]);
+            }
         }
-        dynarr_frame_entry_free(f->globals);
         free(f->globals);
     }
-    dynarr_int_free(&f->entry_indexs);
-    dynarr_int_free(&f->stack_pointers);
+    /* close the holes: they can no longer read from this frame, so the
+     * objects of their slots are moved into them */
+    while (f->holes != NULL) {
+        hole_t* next = f->holes->next;
+        frame_entry_t* slot = &f->stack.data[f->holes->index];
+        if (!is_held_by_own_hole(slot->object, f->holes)) {
+            f->holes->object = slot->object;
+            slot->object = NULL;
+        }
+        f->holes->frame = NULL;
+        hole_deref(f->holes);
+        f->holes = next;
+    }
     for (i = 0; i < f->stack.size; i++) {
-        object_deref(dynarr_frame_entry_at(&f->stack, i)->object);
+        entry_deref(dynarr_frame_entry_at(&f->stack, i));
+    }
+    parent = f->parent;
+    if (f->stack.data != (frame_entry_t*)(f + 1)) {
+        /* the stack is not allocated along with the frame, or it has grown
+         * out of it */
+        dynarr_frame_entry_free(&f->stack);
+    }
+    if (IS_IN_ACTIVATION_STACK(f)) {
+        /* frames in activation stack are always freed in reverse order */
+        assert((void*)f < activation_stack.ptr + activation_stack.size);
+        activation_stack.size = (void*)f - activation_stack.ptr;
+    } else {
+        free(f);
+    }
+    if (parent != NULL) {
+        frame_free(parent);
     }
-    dynarr_frame_entry_free(&f->stack);
-    free(f);
 }
 
-/* push new stack_start_index */
-inline void
-frame_push_stack(frame_t* f, int entry_index)
+/* create an empty frame of the entry enclosed by the frame. the new frame
+ * takes over the reference of the enclosing frame */
+inline frame_t*
+frame_enter(frame_t* f, const int entry_index)
 {
+    frame_t* inner_frame = frame_new_fixed(f, 0, 0);
 #ifdef ENABLE_DEBUG_LOG_MORE
-    printf("frame_push_stack: %p\n", f);
+    printf("frame_enter: %p\n", f);
 #endif
-    dynarr_int_append(&f->entry_indexs, &entry_index);
-    dynarr_int_append(&f->stack_pointers, &(f->stack.size));
+    inner_frame->stack = dynarr_frame_entry_new();
+    inner_frame->entry_index = entry_index;
+    inner_frame->parent = f;
+    return inner_frame;
 }
 
-/* deref and pop objects in the last section of stack */
-inline void
-frame_pop_stack(frame_t* f)
+/* free the frame and return its enclosing frame */
+inline frame_t*
+frame_leave(frame_t* f)
 {
+    frame_t* outer_frame = frame_ref(f->parent);
 #ifdef ENABLE_DEBUG_LOG_MORE
-    printf("frame_pop_stack: %p\n", f);
+    printf("frame_leave: %p\n", f);
 #endif
-    int i, stack_start_index;
-    if (f->entry_indexs.size == 0) {
-        return;
-    }
-    stack_start_index = *dynarr_int_back(&f->stack_pointers);
-    for (i = f->stack.size; i > stack_start_index; i--) {
-        object_deref(dynarr_frame_entry_back(&f->stack)->object);
-        dynarr_frame_entry_pop(&f->stack);
+    frame_free(f);
+    return outer_frame;
+}
+
+/* get the object of the entry, or read it from the hole if the entry is not
+ * initialized. return NULL if neither is initialized */
+static inline object_t*
+entry_get_object(const frame_entry_t* entry)
+{
+    if (entry->object == NULL && entry->hole != NULL) {
+        if (entry->hole->frame != NULL) {
+            return entry->hole->frame->stack.data[entry->hole->index].object;
+        }
+        return entry->hole->object;
     }
-    dynarr_int_pop(&f->entry_indexs);
-    dynarr_int_pop(&f->stack_pointers);
+    return entry->object;
 }
 
+/* look up the identifier by its id code in the frame, the enclosing frames
+ * and the globals */
 inline object_t*
 frame_get(const frame_t* f, const int code)
 {
 #ifdef ENABLE_DEBUG_LOG_MORE
     printf("frame_get: %p\n", f);
 #endif
-    /* search stack from top to bottom */
-    int i, j;
-    for (i = f->stack.size - 1; i >= 0; i--) {
-        frame_entry_t* pair = dynarr_frame_entry_at(&f->stack, i);
-        if (code == pair->code) {
-            return pair->object;
+    /* search stacks from inner to outer */
+    int i;
+    const frame_t* cur_frame;
+    for (cur_frame = f; cur_frame != NULL; cur_frame = cur_frame->parent) {
+        for (i = cur_frame->stack.size - 1; i >= 0; i--) {
+            frame_entry_t* pair = dynarr_frame_entry_at(&cur_frame->stack, i);
+            if (code == pair->code) {
+                object_t* obj = entry_get_object(pair);
+                if (obj != NULL) {
+                    return obj;
+                }
+            }
         }
     }
-    /* search in global */
-    for (j = 0; j < f->globals->size; j++) {
-        frame_entry_t* pair = dynarr_frame_entry_at(f->globals, j);
-        if (code == pair->code) {
-            return pair->object;
-        }
+    return frame_get_global(f, code);
+}
+
+/* get the entry of the local address and the frame that holds it */
+static inline frame_entry_t*
+frame_local_entry(const frame_t* f, const uint32_t addr, const frame_t** owner)
+{
+    *owner = LOCAL_ADDR_DEPTH(addr) == SLOT_DEPTH ? f : f->parent;
+    return &(*owner)->stack.data[LOCAL_ADDR_SLOT(addr)];
+}
+
+/* get the object at the local address, or read it from its hole if it is
+ * not initialized yet. the scope pass only gives local addresses to reads
+ * that always find it initialized */
+inline object_t*
+frame_get_local(const frame_t* f, const uint32_t addr)
+{
+    const frame_t* owner;
+    return entry_get_object(frame_local_entry(f, addr, &owner));
+}
+
+/* get the id code of the local address */
+int
+frame_get_local_code(const frame_t* f, const uint32_t addr)
+{
+    const frame_t* owner;
+    return frame_local_entry(f, addr, &owner)->code;
+}
+
+/* set the object to the local address. return NULL if it is initialized */
+inline object_t**
+frame_set_local(frame_t* f, const uint32_t addr, object_t* obj)
+{
+    const frame_t* owner;
+    frame_entry_t* entry = frame_local_entry(f, addr, &owner);
+    if (entry->object != NULL) {
+        return NULL;
     }
-    return NULL;
+    entry->object = object_ref(obj);
+    return &entry->object;
 }
 
+inline object_t*
+frame_get_global(const frame_t* f, const int code)
+{
+    return f->globals[code];
+}
+
+/* set the object to globals. return NULL if it is initialized */
+inline object_t**
+frame_set_global(frame_t* f, const int code, object_t* obj)
+{
+    if (f->globals[code] != NULL) {
+        return NULL;
+    }
+    f->globals[code] = object_ref(obj);
+    return &f->globals[code];
+}
+
+/* set the object to the identifier by its id code. if the frame has a slot
+ * of the identifier, the object is set to the slot, otherwise a new entry is
+ * added. return NULL if it is initialized */
 inline object_t**
 frame_set(frame_t* f, const int code, object_t* obj)
 {
 #ifdef ENABLE_DEBUG_LOG_MORE
     printf("frame_set: %p\n", f);
 #endif
-    int i, start, end;
-    dynarr_frame_entry_t* target;
-    object_t* found_obj = NULL;
-    if (f->entry_indexs.size == 0) {
-        target = f->globals;
-        start = 0;
-        end = f->globals->size;
-    } else {
-        target = &f->stack;
-        start = *dynarr_int_back(&f->stack_pointers);
-        end = f->stack.size;
-    }
-    for (i = start; i < end; i++) {
-        if (code == (dynarr_frame_entry_at(target, i))->code) {
-            found_obj = (dynarr_frame_entry_at(target, i))->object;
-            break;
+    int i;
+    dynarr_frame_entry_t* target = &f->stack;
+    if (f->entry_index == -1) {
+        return frame_set_global(f, code, obj);
+    }
+    for (i = 0; i < target->size; i++) {
+        frame_entry_t* pair = dynarr_frame_entry_at(target, i);
+        if (code == pair->code) {
+            /* found collision: return NULL */
+            if (pair->object != NULL) {
+                return NULL;
+            }
+            pair->object = object_ref(obj);
+            return &pair->object;
         }
     }
-    /* found collision: return NULL */
-    if (found_obj) {
-        return NULL;
+    /* the fixed stack allocated along with the frame is moved out to grow */
+    if (target->data == (frame_entry_t*)(f + 1)) {
+        frame_entry_t* data
+            = malloc((target->size + DYNARR_INIT_CAP) * sizeof(frame_entry_t));
+        assert(data != NULL);
+        memcpy(data, target->data, target->size * sizeof(frame_entry_t));
+        target->data = data;
+        target->cap = target->size + DYNARR_INIT_CAP;
     }
     frame_entry_t new_pair = {
         .code = code,
         .object = object_ref(obj),
+        .hole = NULL,
     };
     dynarr_frame_entry_append(target, &new_pair);
     return &(dynarr_frame_entry_back(target)->object);
@@ -188,7 +373,7 @@ frame_set(frame_t* f, const int code, object_t* obj)
 int
 frame_print(frame_t* f)
 {
-    int i = 0;
+    int i = 0, is_first;
     int printed_bytes_count = 0;
     if (!f) {
         return printf("[Frame NULL]");
@@ -197,38 +382,22 @@ frame_print(frame_t* f)
         "[Frame addr=%p ", PTR_L20BITS(f)
     );
     /* global */
-    printed_bytes_count += printf("globals(%d)=[", f->globals->size);
-    for (i = 0; i < f->globals->size; i++) {
-        frame_entry_t* pair = dynarr_frame_entry_at(f->globals, i);
-        if (i != 0) {
+    printed_bytes_count += printf("globals=[");
+    for (i = 0, is_first = 1; i < f->globals_size; i++) {
+        if (f->globals[i] == NULL) {
+            continue;
+        }
+        if (!is_first) {
             printed_bytes_count += printf(", ");
         }
         printed_bytes_count += printf(
-            "(id_code=%d addr=%p type=%s)", pair->code,
-            PTR_L20BITS(pair->object), OBJ_TYPE_SIG_STR[pair->object->type]
+            "(id_code=%d addr=%p type=%s)", i, PTR_L20BITS(f->globals[i]),
+            OBJ_TYPE_SIG_STR[OBJ_TYPE(f->globals[i])]
         );
+        is_first = 0;
     }
     printed_bytes_count += printf("], ");
-    /* call stack */
-    printed_bytes_count += printf("call_stacks(%d)=[", f->entry_indexs.size);
-    for (i = 0; i < f->entry_indexs.size; i++) {
-        int entry_index = *dynarr_int_at(&f->entry_indexs, i);
-        if (i != 0) {
-            printed_bytes_count += printf(", ");
-        }
-        printed_bytes_count += printf("%d", entry_index);
-    }
-    printed_bytes_count += printf("], ");
-    /* stack pointers */
-    printed_bytes_count += printf("stack_tops(%d)=[", f->stack_pointers.size);
-    for (i = 0; i < f->stack_pointers.size; i++) {
-        int sp = *dynarr_int_at(&f->stack_pointers, i);
-        if (i != 0) {
-            printed_bytes_count += printf(", ");
-        }
-        printed_bytes_count += printf("%d", sp);
-    }
-    printed_bytes_count += printf("], ");
+    printed_bytes_count += printf("entry_index=%d ", f->entry_index);
     /* stack entrys */
     printed_bytes_count += printf("stack(%d)=[", f->stack.size);
     for (i = 0; i < f->stack.size; i++) {
@@ -236,87 +405,187 @@ frame_print(frame_t* f)
         if (i != 0) {
             printed_bytes_count += printf(", ");
         }
+        if (pair->object == NULL && pair->hole != NULL) {
+            printed_bytes_count += printf(
+                "(id_code=%d hole=%p)", pair->code, PTR_L20BITS(pair->hole)
+            );
+            continue;
+        } else if (pair->object == NULL) {
+            printed_bytes_count
+                += printf("(id_code=%d uninitialized)", pair->code);
+            continue;
+        }
         printed_bytes_count += printf(
             "(id_code=%d addr=%p type=%s)", pair->code,
-            PTR_L20BITS(pair->object), OBJ_TYPE_SIG_STR[pair->object->type]
+            PTR_L20BITS(pair->object),
+            OBJ_TYPE_SIG_STR[OBJ_TYPE(pair->object)]
         );
     }
-    printed_bytes_count += printf("]]");
+    printed_bytes_count += printf("], parent=");
+    /* the enclosing frame shares the globals so only print its stack */
+    for (f = f->parent; f != NULL; f = f->parent) {
+        printed_bytes_count += printf(
+            "[Frame addr=%p entry_index=%d stack(%d)] ", PTR_L20BITS(f),
+            f->entry_index, f->stack.size
+        );
+    }
+    printed_bytes_count += printf("]");
     fflush(stdout);
     return printed_bytes_count;
 }
 
-frame_t*
-frame_get_callee_frame(const frame_t* caller_frame, const object_t* func_obj)
+/* get the hole that reads the slot at the index of the frame's stack */
+static hole_t*
+frame_open_hole(frame_t* f, const int index)
 {
-    frame_t* callee_frame;
-    callable_t callable_obj = func_obj->as.callable;
-    int i, is_forked = 0;
-    int caller_entry_index = -1;
-    if (caller_frame->entry_indexs.size != 0) {
-        caller_entry_index = *dynarr_int_back(&caller_frame->entry_indexs);
-    }
-
-    /* if is direct recursion, copy caller frame except last stack section */
-    if (caller_frame->stack.size > 0
-        && caller_entry_index == callable_obj.index) {
-        callee_frame = frame_copy(caller_frame);
-        frame_pop_stack(callee_frame); /* this remove the last stack */
-        frame_push_stack(callee_frame, callable_obj.index);
-        return callee_frame;
-    }
-
-    /* starting from i = 0, if the i-th func_ptr of the init-frame and caller
-     * frame is the same, the i-th frame of callee frame is caller's i-th frame.
-     * otherwise, they are in different closure path, the rest of init-time
-     * frame stack is used */
-    callee_frame = frame_new(callable_obj.init_frame);
-
-    /* for every function's init-time frame */
-    for (i = 0; i < callable_obj.init_frame->entry_indexs.size; i++) {
-        int j, start, end;
-        const frame_t* src_frame;
-        int func_init_index = callable_obj.init_frame->entry_indexs.data[i];
-        int caller_index = -1;
-
-        /* get caller frame's entry index at this step of closure path */
-        if (i < caller_frame->entry_indexs.size) {
-            caller_index = *dynarr_int_at(&caller_frame->entry_indexs, i);
+    hole_t* h;
+    for (h = f->holes; h != NULL; h = h->next) {
+        if (h->index == index) {
+            return h;
         }
-        /* push the init-time frame's entry_index to callee */
-        dynarr_int_append(&callee_frame->entry_indexs, &func_init_index);
-        /* push the current stack size to stack pointers */
-        dynarr_int_append(
-            &callee_frame->stack_pointers, &callee_frame->stack.size
-        );
-        /* choose the source frame to copy */
-        if (!is_forked && caller_index == func_init_index) {
-#ifdef ENABLE_DEBUG_LOG_MORE
-            printf("frame_get_callee_frame: stack[%d] use caller\n", i);
-#endif
-            src_frame = caller_frame;
-        } else {
-#ifdef ENABLE_DEBUG_LOG_MORE
-            printf("frame_get_callee_frame: stack[%d] use init-time\n", i);
-#endif
-            src_frame = callable_obj.init_frame;
-            is_forked = 1;
-        }
-        /* copy the i-th section of the source frame's stack to callee */
-        start = *dynarr_int_at(&src_frame->stack_pointers, i);
-        end = (i + 1 < src_frame->stack_pointers.size)
-            ? *dynarr_int_at(&src_frame->stack_pointers, i + 1)
-            : src_frame->stack.size;
-#ifdef ENABLE_DEBUG_LOG_MORE
-        printf("frame_get_callee_frame: start,end = %d,%d\n", start, end);
-#endif
-        for (j = start; j < end; j++) {
-            frame_entry_t* pair = dynarr_frame_entry_at(&src_frame->stack, j);
-            object_ref(pair->object);
-            dynarr_frame_entry_append(&callee_frame->stack, pair);
+    }
+    h = malloc(sizeof(hole_t));
+    assert(h != NULL);
+    /* the frame holds a reference until it closes the hole */
+    *h = (hole_t) {
+        .ref_count = 1,
+        .index = index,
+        .frame = f,
+        .object = NULL,
+        .next = f->holes,
+    };
+    f->holes = h;
+    return h;
+}
+
+/* get a copy of the entry at the index of the frame's stack for an init-time
+ * frame. if the entry is not initialized, the copy reads it through its hole
+ * while the hole is open. a hole is opened for it if it is a slot of the
+ * frame */
+static frame_entry_t
+frame_capture_entry(frame_t* f, const int index, const int is_slot)
+{
+    frame_entry_t entry = f->stack.data[index];
+    entry.object = entry_get_object(&entry);
+    if (entry.object != NULL
+        || (entry.hole != NULL && entry.hole->frame == NULL)) {
+        entry.hole = NULL;
+    } else if (entry.hole == NULL && is_slot) {
+        entry.hole = frame_open_hole(f, index);
+    }
+    entry_ref(&entry);
+    return entry;
+}
+
+/* create the init-time frame of a function whose scope is dynamic. it holds
+ * every identifier that can be seen in the frame, the inner one first */
+static frame_t*
+frame_snapshot(frame_t* f)
+{
+    int i, j;
+    frame_t* cur_frame;
+    frame_t* init_frame = frame_new_fixed(f, 0, 0);
+    init_frame->stack = dynarr_frame_entry_new();
+    init_frame->entry_index = f->entry_index;
+    for (cur_frame = f; cur_frame != NULL; cur_frame = cur_frame->parent) {
+        for (i = 0; i < cur_frame->stack.size; i++) {
+            frame_entry_t entry;
+            for (j = 0; j < init_frame->stack.size; j++) {
+                if (init_frame->stack.data[j].code
+                    == cur_frame->stack.data[i].code) {
+                    break;
+                }
+            }
+            if (j < init_frame->stack.size) {
+                continue;
+            }
+            entry = frame_capture_entry(cur_frame, i, cur_frame == f);
+            if (entry.object == NULL && entry.hole == NULL) {
+                continue;
+            }
+            dynarr_frame_entry_append(&init_frame->stack, &entry);
         }
     }
-    /* then push the new stack section and entry index to callee frame */
-    frame_push_stack(callee_frame, callable_obj.index);
+    return init_frame;
+}
+
+/* create the init-time frame of a function created in the frame. it holds
+ * the identifiers captured by the scope of the function */
+frame_t*
+frame_capture(frame_t* f, const scope_t* scope)
+{
+    int i;
+    frame_t* init_frame;
+    if (scope->is_dynamic) {
+        return frame_snapshot(f);
+    }
+    init_frame = frame_new_fixed(f, scope->capture_codes.size, 0);
+    init_frame->entry_index = f->entry_index;
+    for (i = 0; i < scope->capture_codes.size; i++) {
+        uint32_t addr = scope->capture_addrs.data[i];
+        frame_t* owner
+            = (LOCAL_ADDR_DEPTH(addr) == SLOT_DEPTH) ? f : f->parent;
+        init_frame->stack.data[i] = frame_capture_entry(
+            owner, LOCAL_ADDR_SLOT(addr), owner == f
+        );
+    }
+    return init_frame;
+}
+
+/* initialize the slots of the scope in the frame */
+static inline void
+frame_init_slots(frame_t* f, const scope_t* scope)
+{
+    int i;
+    for (i = 0; i < scope->slot_codes.size; i++) {
+        f->stack.data[i] = (frame_entry_t) {
+            .code = scope->slot_codes.data[i],
+            .object = NULL,
+            .hole = NULL,
+        };
+    }
+}
+
+/* the callee frame only has the function's slots. its parent is the
+ * init-time frame of the function, which is shared instead of copied */
+frame_t*
+frame_get_callee_frame(const object_t* func_obj, const scope_t* callee_scope)
+{
+    frame_t* init_frame = func_obj->as.callable.init_frame;
+    frame_t* callee_frame = frame_new_fixed(
+        init_frame, callee_scope->slot_codes.size, !callee_scope->has_closure
+    );
+    callee_frame->entry_index = func_obj->as.callable.index;
+    callee_frame->parent = frame_ref(init_frame);
+    frame_init_slots(callee_frame, callee_scope);
     return callee_frame;
 }
+
+/* get the callee frame of a call at tail position. the caller frame will not
+ * be used after the call, so it is released here. if no one else holds the
+ * caller frame and it is a frame of the same closure, its slots are reset in
+ * place instead */
+frame_t*
+frame_get_tail_callee_frame(
+    frame_t* caller_frame, const object_t* func_obj,
+    const scope_t* callee_scope
+)
+{
+    int i;
+    if (caller_frame->ref_count == 1 && caller_frame->holes == NULL
+        && caller_frame->entry_index == func_obj->as.callable.index
+        && caller_frame->parent == func_obj->as.callable.init_frame) {
+        for (i = 0; i < caller_frame->stack.size; i++) {
+            entry_deref(&caller_frame->stack.data[i]);
+        }
+        /* drop the entries set by id code after the slots */
+        caller_frame->stack.size = callee_scope->slot_codes.size;
+        frame_init_slots(caller_frame, callee_scope);
+        return caller_frame;
+    }
+
+    /* free the caller first so that the callee can take its place in the
+     * activation stack */
+    frame_free(caller_frame);
+    return frame_get_callee_frame(func_obj, callee_scope);
+}
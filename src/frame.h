@@ -1,12 +1,27 @@
 #include "objects.h"
+#include "scope.h"
 #include "utils/dynarr_int.h"
 
 #ifndef FRAME_H
 #define FRAME_H
 
+/* A captured identifier that was not initialized when the function was
+ * created. It reads the slot of the frame that initializes the identifier
+ * until that frame is freed. Then the hole is closed and the object of the
+ * slot is moved into it.
+ */
+typedef struct hole {
+    int ref_count;
+    int index; /* index of the slot in the stack of the frame */
+    frame_t* frame; /* NULL after the frame is freed */
+    object_t* object; /* the object of the slot after the hole is closed */
+    struct hole* next; /* next hole opened by the same frame */
+} hole_t;
+
 typedef struct frame_entry {
     int code;
-    object_t* object;
+    object_t* object; /* NULL if uninitialized */
+    hole_t* hole; /* where to read the object if it is uninitialized */
 } frame_entry_t;
 
 #define TYPE frame_entry_t
@@ -15,23 +30,33 @@ typedef struct frame_entry {
 #undef TYPE_NAME
 #undef TYPE
 
+/* A frame is the environment of an activation. The stack of a function's
+ * frame holds the slots of the function and its parent is the init-time
+ * frame of the function, which holds the identifiers it captured. Frames are
+ * shared by reference so a call only allocates its own slots.
+ */
 typedef struct frame {
     int ref_count;
 
     /* do we own the globals? if true, we can free it */
     int is_own_globals;
 
-    /* the reference to the global stack that stores shared code-object pairs */
-    dynarr_frame_entry_t* globals;
+    /* the reference to the shared globals indexed by id code. the object
+     * is NULL if the identifier is uninitialized */
+    object_t** globals;
+    int globals_size;
 
-    /* stores the functions that growed each stack section */
-    dynarr_int_t entry_indexs;
+    /* the function that created this frame, -1 for the root */
+    int entry_index;
 
-    /* store the start index of each stack section */
-    dynarr_int_t stack_pointers;
+    /* the enclosing frame, NULL if none */
+    frame_t* parent;
 
-    /* stores the code-object pairs for function stack on a dynamic array */
+    /* stores the code-object pairs of this frame */
     dynarr_frame_entry_t stack;
+
+    /* the holes that read the slots of this frame */
+    hole_t* holes;
 } frame_t;
 
 #define frame_struct_size sizeof(frame_t)
@@ -43,25 +68,40 @@ typedef struct frame {
 #undef TYPE
 
 
-extern frame_t* frame_new(const frame_t* parent);
-
-extern frame_t* frame_copy(const frame_t* f);
+extern frame_t* frame_new(const int max_id_code);
 
 extern frame_t* frame_ref(frame_t* f);
 
 extern void frame_free(frame_t* f);
 
-extern void frame_push_stack(frame_t* f, const int entry_index);
+extern frame_t* frame_enter(frame_t* f, const int entry_index);
 
-extern void frame_pop_stack(frame_t* f);
+extern frame_t* frame_leave(frame_t* f);
 
 extern object_t* frame_get(const frame_t* f, const int code);
 
 extern object_t** frame_set(frame_t* f, const int code, object_t* obj);
 
+extern object_t* frame_get_local(const frame_t* f, const uint32_t addr);
+
+extern int frame_get_local_code(const frame_t* f, const uint32_t addr);
+
+extern object_t**
+frame_set_local(frame_t* f, const uint32_t addr, object_t* obj);
+
+extern object_t* frame_get_global(const frame_t* f, const int code);
+
+extern object_t** frame_set_global(frame_t* f, const int code, object_t* obj);
+
 extern int frame_print(frame_t* f);
 
+extern frame_t* frame_capture(frame_t* f, const scope_t* scope);
+
 extern frame_t*
-frame_get_callee_frame(const frame_t* caller_frame, const object_t* func);
+frame_get_callee_frame(const object_t* func, const scope_t* callee_scope);
+
+extern frame_t* frame_get_tail_callee_frame(
+    frame_t* caller_frame, const object_t* func, const scope_t* callee_scope
+);
 
 #endif
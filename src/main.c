@@ -18,6 +18,7 @@ arena_t token_str_arena;
 
 int global_is_enable_debug_log;
 int global_is_compile;
+int global_is_enable_background_free;
 
 struct fam_str {
     size_t size;
@@ -149,7 +150,9 @@ const char* usage
       "\t-C, --compile[={FILE}]: transpile program to C and compile it to "
       "{FILE} ({FILE} default is 'a.out')\n"
       "\t-A, --args[={CC ARGUMENT}]: The additional C compiler arguments "
-      "other than -Wall.\n";
+      "other than -Wall.\n"
+      "\t--no-background-free: free large garbage in the interpreter thread "
+      "instead of a background thread\n";
 
 int
 main(int argc, char** argv)
@@ -166,6 +169,7 @@ main(int argc, char** argv)
         { "debug", no_argument, NULL, 'd' },
         { "compile", optional_argument, NULL, 'C' },
         { "args", required_argument, NULL, 'A' },
+        { "no-background-free", no_argument, NULL, 'F' },
         { NULL, 0, NULL, 0 },
     };
 
@@ -177,6 +181,7 @@ main(int argc, char** argv)
     };
     global_is_enable_debug_log = 0;
     global_is_compile = 0;
+    global_is_enable_background_free = 1;
 
     /* parse arg */
     while ((opt = getopt_long(argc, argv, "dC::A:", long_opts, NULL)) != -1) {
@@ -202,6 +207,9 @@ main(int argc, char** argv)
             addl_cc_args_count++;
             addl_cc_args[addl_cc_args_count] = NULL;
             break;
+        case 'F':
+            global_is_enable_background_free = 0;
+            break;
         case '?':
             puts(usage);
             return 1;
@@ -27,12 +27,121 @@ number_free(number_t* x)
     bi_free(&x->denom);
 }
 
+/* make a bigint from its absolute value and sign */
+static bigint_t
+bi_from_u64(u64 j, int sign)
+{
+    bigint_t x = ZERO_BIGINT;
+    if (j == 0) {
+        return ZERO_BIGINT;
+    }
+    if (sign == 0 && j <= 256) {
+        return BYTE_BIGINT(j);
+    }
+    bi_new(&x, 1);
+    x.digit[0] = j;
+    x.sign = sign;
+    return x;
+}
+
+/* if the bigint is in (-2^63, 2^63), write it to n and return 1, otherwise
+ * return 0 */
+static int
+bi_to_i64(const bigint_t* x, i64* n)
+{
+    u64 j;
+    if (x->nan) {
+        return 0;
+    }
+    if (x->size > 1 || (x->size == 1 && (x->digit[0] >> 63))) {
+        return 0;
+    }
+    j = x->size ? x->digit[0] : 0;
+    *n = x->sign ? -(i64)j : (i64)j;
+    return 1;
+}
+
+/* Numbers whose numerator and denominator both fit in i64 are computed as
+ * i64 fractions instead of bigints. Every step is checked for overflow and
+ * the bigint path is taken if any of them overflows, so the results are
+ * exactly the same.
+ */
+typedef struct i64_frac {
+    i64 numer;
+    i64 denom;
+} i64_frac_t;
+
+#if defined(__GNUC__)
+#define ADD_OVERFLOW(a, b, res) __builtin_add_overflow(a, b, res)
+#define MUL_OVERFLOW(a, b, res) __builtin_mul_overflow(a, b, res)
+#else
+/* always take the bigint path */
+#define ADD_OVERFLOW(a, b, res) 1
+#define MUL_OVERFLOW(a, b, res) 1
+#endif
+
+static inline int
+number_to_i64_frac(const number_t* x, i64_frac_t* f)
+{
+    return bi_to_i64(&x->numer, &f->numer) && bi_to_i64(&x->denom, &f->denom);
+}
+
+static inline u64
+u64_gcd(u64 a, u64 b)
+{
+    while (b != 0) {
+        u64 t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* normalize the fraction into x. return 0 if it can not be done in i64 */
+static int
+number_from_i64_frac(i64_frac_t f, number_t* x)
+{
+    u64 n, d, g;
+    if (f.numer == INT64_MIN || f.denom == INT64_MIN) {
+        return 0;
+    }
+    if (f.numer == 0) {
+        *x = ZERO_NUMBER;
+        return 1;
+    }
+    if (f.denom == 0) {
+        *x = NAN_NUMBER;
+        return 1;
+    }
+    n = f.numer < 0 ? -f.numer : f.numer;
+    d = f.denom < 0 ? -f.denom : f.denom;
+    g = u64_gcd(n, d);
+    x->numer = bi_from_u64(n / g, (f.numer < 0) != (f.denom < 0));
+    x->denom = bi_from_u64(d / g, 0);
+    return 1;
+}
+
+/* res = a + b. return 0 if overflowed */
+static inline int
+i64_frac_add(const i64_frac_t* a, const i64_frac_t* b, i64_frac_t* res)
+{
+    i64 t1, t2;
+    if (a->denom == b->denom) {
+        res->denom = a->denom;
+        return !ADD_OVERFLOW(a->numer, b->numer, &res->numer);
+    }
+    return !MUL_OVERFLOW(a->numer, b->denom, &t1)
+        && !MUL_OVERFLOW(b->numer, a->denom, &t2)
+        && !ADD_OVERFLOW(t1, t2, &res->numer)
+        && !MUL_OVERFLOW(a->denom, b->denom, &res->denom);
+}
+
 void
 number_normalize(number_t* x)
 {
     int sign = 0;
-    bigint_t a = ZERO_BIGINT, b = ZERO_BIGINT, t1 = ZERO_BIGINT,
-             t2 = ZERO_BIGINT, one = BYTE_BIGINT(1);
+    bigint_t a = ZERO_BIGINT, t1 = ZERO_BIGINT, t2 = ZERO_BIGINT,
+             one = BYTE_BIGINT(1);
 
     /* flags */
     if (x->numer.nan || x->denom.nan) {
@@ -42,6 +151,12 @@ number_normalize(number_t* x)
         x->denom = NAN_BIGINT();
     }
 
+    /* normalize the sign before the special cases return */
+    if (x->numer.sign != x->denom.sign) {
+        sign = 1;
+    }
+    x->numer.sign = x->denom.sign = 0;
+
     /* special cases */
     /* n = 0 */
     if (x->numer.size == 0) {
@@ -52,6 +167,7 @@ number_normalize(number_t* x)
     }
     /* n == 1 or d = 1 */
     if (bi_eq(&x->numer, &one) || bi_eq(&x->denom, &one)) {
+        x->numer.sign = sign;
         return;
     }
     /* d == 0 */
@@ -67,48 +183,22 @@ number_normalize(number_t* x)
         bi_free(&x->denom);
         x->numer = BYTE_BIGINT(1);
         x->denom = BYTE_BIGINT(1);
+        x->numer.sign = sign;
         return;
     }
 
-    /* normalize the sign */
-    if (x->numer.sign != x->denom.sign) {
-        sign = 1;
-    }
-    x->numer.sign = x->denom.sign = 0;
-
-    /* euclidian algorithm */
-    bi_copy(&a, &x->numer);
-    bi_copy(&b, &x->denom);
-    /* printf("a "); bi_print(&a, '\n');
-    printf("b "); bi_print(&b, '\n'); */
-    while (b.size != 0) {
-        bi_free(&t2);
-        t2 = bi_mod(&a, &b); /* t2 = a mod b */
-        bi_free(&a);
-        bi_copy(&a, &b); /* a = t1 */
-        bi_free(&b);
-        bi_copy(&b, &t2); /* b = t2 */
-        /* printf("a "); bi_print(&a, '\n');
-        printf("b "); bi_print(&b, '\n'); */
-    }
-
     /* a is gcd of numer & denom */
+    a = bi_gcd(&x->numer, &x->denom);
     if (!bi_eq(&a, &one)) {
-        bi_free(&t1);
-        t1 = bi_div(&x->numer, &a);
+        t1 = bi_divexact(&x->numer, &a);
         bi_free(&x->numer);
         x->numer = t1;
-        bi_free(&t2);
-        t2 = bi_div(&x->denom, &a);
+        t2 = bi_divexact(&x->denom, &a);
         bi_free(&x->denom);
         x->denom = t2;
         /* dont need to free t1 and t2 because they are own by x now */
-    } else {
-        bi_free(&t1);
-        bi_free(&t2);
     }
     bi_free(&a);
-    bi_free(&b);
     x->numer.sign = sign;
 }
 
@@ -134,6 +224,15 @@ number_lt(number_t* a, number_t* b)
     if (a->numer.nan || b->numer.nan) {
         return 0;
     }
+    {
+        i64_frac_t fa, fb;
+        i64 l, r;
+        if (number_to_i64_frac(a, &fa) && number_to_i64_frac(b, &fb)
+            && !MUL_OVERFLOW(fa.numer, fb.denom, &l)
+            && !MUL_OVERFLOW(fb.numer, fa.denom, &r)) {
+            return l < r;
+        }
+    }
     /* obvious cases */
     if ((a->numer.sign != b->numer.sign)) {
         return a->numer.sign;
@@ -151,7 +250,8 @@ number_lt(number_t* a, number_t* b)
         return bi_lt(&a->numer, &b->numer);
     }
     if (bi_eq(&a->numer, &b->numer)) {
-        return bi_lt(&b->denom, &a->denom);
+        /* larger denominator is closer to zero */
+        return bi_lt(&b->denom, &a->denom) != a->numer.sign;
     }
     /* generl case */
     {
@@ -181,6 +281,7 @@ number_add(number_t* a, number_t* b)
 {
     number_t res = EMPTY_NUMBER;
     bigint_t t1 = ZERO_BIGINT, t2 = ZERO_BIGINT;
+    i64_frac_t fa, fb, f;
     if (a->numer.nan || b->numer.nan) {
         return NAN_NUMBER;
     }
@@ -195,6 +296,10 @@ number_add(number_t* a, number_t* b)
         number_copy(&res, a);
         return res;
     }
+    if (number_to_i64_frac(a, &fa) && number_to_i64_frac(b, &fb)
+        && i64_frac_add(&fa, &fb, &f) && number_from_i64_frac(f, &res)) {
+        return res;
+    }
     t1 = bi_mul(&a->numer, &b->denom);
     t2 = bi_mul(&b->numer, &a->denom);
     res.numer = bi_add(&t1, &t2);
@@ -210,6 +315,7 @@ number_sub(number_t* a, number_t* b)
 {
     number_t res = EMPTY_NUMBER;
     bigint_t t1 = ZERO_BIGINT, t2 = ZERO_BIGINT;
+    i64_frac_t fa, fb, f;
     if (a->numer.nan || b->numer.nan) {
         return NAN_NUMBER;
     }
@@ -225,6 +331,13 @@ number_sub(number_t* a, number_t* b)
         number_copy(&res, a);
         return res;
     }
+    if (number_to_i64_frac(a, &fa) && number_to_i64_frac(b, &fb)) {
+        /* the range of i64_frac is symmetric so the negation is safe */
+        fb.numer = -fb.numer;
+        if (i64_frac_add(&fa, &fb, &f) && number_from_i64_frac(f, &res)) {
+            return res;
+        }
+    }
     t1 = bi_mul(&a->numer, &b->denom);
     t2 = bi_mul(&b->numer, &a->denom);
     res.numer = bi_sub(&t1, &t2);
@@ -239,22 +352,69 @@ inline number_t
 number_mul(number_t* a, number_t* b)
 {
     number_t res = EMPTY_NUMBER;
+    i64_frac_t fa, fb, f;
     if (a->numer.nan || b->numer.nan) {
         return NAN_NUMBER;
     }
     if (a->numer.size == 0 || b->numer.size == 0) {
         return ZERO_NUMBER;
     }
+    if (number_to_i64_frac(a, &fa) && number_to_i64_frac(b, &fb)
+        && !MUL_OVERFLOW(fa.numer, fb.numer, &f.numer)
+        && !MUL_OVERFLOW(fa.denom, fb.denom, &f.denom)
+        && number_from_i64_frac(f, &res)) {
+        return res;
+    }
     res.numer = bi_mul(&a->numer, &b->numer);
     res.denom = bi_mul(&a->denom, &b->denom);
     number_normalize(&res);
     return res;
 }
 
+#define NUMBER_IS_INT(x) ((x)->denom.size == 1 && (x)->denom.digit[0] == 1)
+
+/* The move variants write the result into a, whose old value is dropped.
+ * The numerator of integers is updated in place so its digits are reused. */
+
+void
+number_add_move(number_t* a, number_t* b)
+{
+    number_t res;
+    if (NUMBER_IS_INT(a) && NUMBER_IS_INT(b)) {
+        bi_add_move(&a->numer, &b->numer);
+        return;
+    }
+    res = number_add(a, b);
+    number_free(a);
+    *a = res;
+}
+
+void
+number_sub_move(number_t* a, number_t* b)
+{
+    number_t res;
+    if (NUMBER_IS_INT(a) && NUMBER_IS_INT(b)) {
+        bi_sub_move(&a->numer, &b->numer);
+        return;
+    }
+    res = number_sub(a, b);
+    number_free(a);
+    *a = res;
+}
+
+void
+number_mul_move(number_t* a, number_t* b)
+{
+    number_t res = number_mul(a, b);
+    number_free(a);
+    *a = res;
+}
+
 inline number_t
 number_div(number_t* a, number_t* b)
 {
     number_t res = EMPTY_NUMBER;
+    i64_frac_t fa, fb, f;
     if (a->numer.nan || b->numer.nan) {
         return NAN_NUMBER;
     }
@@ -264,6 +424,12 @@ number_div(number_t* a, number_t* b)
     if (b->numer.size == 0) {
         return NAN_NUMBER;
     }
+    if (number_to_i64_frac(a, &fa) && number_to_i64_frac(b, &fb)
+        && !MUL_OVERFLOW(fa.numer, fb.denom, &f.numer)
+        && !MUL_OVERFLOW(fa.denom, fb.numer, &f.denom)
+        && number_from_i64_frac(f, &res)) {
+        return res;
+    }
     res.numer = bi_mul(&a->numer, &b->denom);
     res.denom = bi_mul(&a->denom, &b->numer);
     number_normalize(&res);
@@ -275,9 +441,22 @@ number_mod(number_t* a, number_t* b)
 {
     number_t res = EMPTY_NUMBER;
     bigint_t t1, t2;
+    i64_frac_t fa, fb, f;
     if (a->numer.nan || b->numer.nan) {
         return NAN_NUMBER;
     }
+    /* bi_mod is floor modulo only when both sides are positive, so leave
+     * the other cases to it */
+    if (number_to_i64_frac(a, &fa) && number_to_i64_frac(b, &fb)
+        && !MUL_OVERFLOW(fa.numer, fb.denom, &f.numer)
+        && !MUL_OVERFLOW(fb.numer, fa.denom, &f.denom) && f.numer >= 0
+        && f.denom > 0) {
+        f.numer %= f.denom;
+        if (!MUL_OVERFLOW(fa.denom, fb.denom, &f.denom)
+            && number_from_i64_frac(f, &res)) {
+            return res;
+        }
+    }
     t1 = bi_mul(&a->numer, &b->denom);
     t2 = bi_mul(&b->numer, &a->denom);
     res.numer = bi_mod(&t1, &t2);
@@ -355,6 +534,11 @@ number_ceil(number_t* a)
     if (a->numer.size == 0) {
         return ZERO_NUMBER;
     }
+    /* integers are their own ceiling and floor */
+    if (a->denom.size == 1 && a->denom.digit[0] == 1) {
+        number_copy(&res, a);
+        return res;
+    }
     /**
      * because bigint division is truncate division
      *   - for positive it is floor (1.5 -> 1)
@@ -383,6 +567,11 @@ number_floor(number_t* a)
     if (a->numer.size == 0) {
         return ZERO_NUMBER;
     }
+    /* integers are their own ceiling and floor */
+    if (a->denom.size == 1 && a->denom.digit[0] == 1) {
+        number_copy(&res, a);
+        return res;
+    }
     if (a->numer.sign) {
 
         t1 = bi_div(&a->numer, &a->denom);
@@ -622,11 +811,7 @@ number_from_i32(i32 i)
     } else {
         j = i;
     }
-    if (j >= DIGIT_BASE) {
-        bi_new(&n.numer, 2);
-        n.numer.digit[0] = j & DIGIT_MASK;
-        n.numer.digit[1] = 1;
-    } else if (sign == 0 && j <= 256) {
+    if (sign == 0 && j <= 256) {
         n.numer = BYTE_BIGINT(j);
     } else {
         bi_new(&n.numer, 1);
@@ -635,3 +820,21 @@ number_from_i32(i32 i)
     n.numer.sign = sign;
     return n;
 }
+
+number_t
+number_from_i64(i64 i)
+{
+    number_t n = ZERO_NUMBER;
+    /* negate as unsigned to prevent overflow at -2^63 */
+    n.numer = bi_from_u64(i < 0 ? -(u64)i : (u64)i, i < 0);
+    return n;
+}
+
+/* if the number is an integer in the range of i64, write it to n and return
+ * 1, otherwise return 0 */
+int
+number_to_i64(const number_t* x, i64* n)
+{
+    return x->denom.size == 1 && x->denom.digit[0] == 1
+        && bi_to_i64(&x->numer, n);
+}
@@ -50,10 +50,16 @@ extern number_t number_exp(number_t* a, number_t* b);
 extern number_t number_ceil(number_t* a);
 extern number_t number_floor(number_t* a);
 
+extern void number_add_move(number_t* a, number_t* b);
+extern void number_sub_move(number_t* a, number_t* b);
+extern void number_mul_move(number_t* a, number_t* b);
+
 extern int number_print_frac(const number_t* x, char end);
 extern dynarr_char_t number_to_dec_string(const number_t* x, int precision);
 extern int number_print_dec(const number_t* x, int precision, char end);
 extern number_t number_from_str(const char* str);
 extern number_t number_from_i32(i32 n);
+extern number_t number_from_i64(i64 n);
+extern int number_to_i64(const number_t* x, i64* n);
 
 #endif
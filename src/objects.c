@@ -3,11 +3,21 @@
 #include "reserved.h"
 #include "token.h"
 #include "utils/errormsg.h"
+#include "utils/global_flags.h"
+#include "utils/slab.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* threads are not available in wasm and memcheck tracks one thread only */
+#if !defined(IS_WASM) && !defined(MEMCHECK_H)
+#define BACKGROUND_FREE
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#endif
+
 const object_t ERR_OBJECT = (object_t) {
     .is_error = 1,
     .is_const = 1,
@@ -25,24 +35,74 @@ const char* OBJ_TYPE_SIG_STR[OBJ_TYPE_SIG_STR_LEN] = {
     "" /* No operand */
 };
 
+/* objects of each type are allocated from the slab of their size. null
+ * objects are all static so their slab is never used */
+static slab_t object_slabs[OBJECT_TYPE_NUM] = {
+    SLAB_INIT(object_t, 1), /* TYPE_NULL */
+    SLAB_INIT_SIZE(OBJECT_SIZE_OF(number_t), 1024), /* TYPE_NUM */
+    SLAB_INIT_SIZE(OBJECT_SIZE_OF(pair_t), 1024), /* TYPE_PAIR */
+    SLAB_INIT_SIZE(OBJECT_SIZE_OF(callable_t), 256), /* TYPE_CALL */
+};
+
 object_t*
 object_create(object_type_enum type, object_data_union data)
 {
-    object_t* object = malloc(sizeof(object_t));
+    slab_t* slab = &object_slabs[type];
+    object_t* object = slab_alloc(slab);
     assert(object != NULL);
-    *object = (object_t) {
-        .is_error = 0,
-        .is_const = 0,
-        .type = type,
-        .ref_count = 1,
-        .as = data,
-    };
+    object->is_error = 0;
+    object->is_const = 0;
+    object->type = type;
+    object->ref_count = 1;
+    /* only the member of the type fits in the cell */
+    memcpy(&object->as, &data, slab->cell_size - OBJECT_HEADER_SIZE);
     return object;
 }
 
+/* create a number object or a small integer from the number. the number is
+ * moved into the object */
+object_t*
+object_from_number(number_t number)
+{
+    i64 i;
+    if (number_to_i64(&number, &i) && IS_SMALL_INT_RANGE(i)) {
+        number_free(&number);
+        return SMALL_INT_OBJECT(i);
+    }
+    return object_create(TYPE_NUM, (object_data_union)number);
+}
+
+/* the number of the object was changed in place. return the object, or the
+ * small integer that replaces it if the number can be one */
+object_t*
+object_renew_number(object_t* obj)
+{
+    i64 i;
+    if (number_to_i64(&obj->as.number, &i) && IS_SMALL_INT_RANGE(i)) {
+        object_deref(obj);
+        return SMALL_INT_OBJECT(i);
+    }
+    return obj;
+}
+
+/* get the number of a number object. if it is a small integer, the number is
+ * made in buf and has to be freed by the caller */
+const number_t*
+object_get_number(const object_t* obj, number_t* buf)
+{
+    if (IS_SMALL_INT(obj)) {
+        *buf = number_from_i64(SMALL_INT_VALUE(obj));
+        return buf;
+    }
+    return &obj->as.number;
+}
+
 object_t*
 object_ref(object_t* obj)
 {
+    if (IS_SMALL_INT(obj)) {
+        return obj;
+    }
 #ifdef ENABLE_DEBUG_LOG_MORE
     printf("object_ref: addr=%p ref_count=%d\n", obj, obj->ref_count);
     fflush(stdout);
@@ -53,24 +113,20 @@ object_ref(object_t* obj)
     return obj;
 }
 
-inline void
-object_deref(object_t* obj)
+/* the objects whose reference count reached zero and are not freed yet.
+ * objects are freed from it in a loop instead of recursively so that freeing
+ * a long list takes constant C stack */
+static dynarr_object_ptr_t dead_objects = { 0, 0, NULL };
+static int is_freeing_dead_objects = 0;
+
+/* free the members of a dead object */
+static inline void
+object_free_members(object_t* obj)
 {
-#ifdef ENABLE_DEBUG_LOG_MORE
-    printf("object_deref: addr=%p, ref_count=%d print: ", obj, obj->ref_count);
-    object_print(obj, '\n');
-    fflush(stdout);
-#endif
-    if (obj->is_const) {
-        return;
-    }
-    if (obj->ref_count != 1) {
-        obj->ref_count--;
-        return;
-    }
     if (obj->type == TYPE_NUM) {
         number_free(&obj->as.number);
     } else if (obj->type == TYPE_PAIR) {
+        /* the right is pushed last so that the tail of a list is freed next */
         if (obj->as.pair.left != NULL) {
             object_deref(obj->as.pair.left);
         }
@@ -86,14 +142,314 @@ object_deref(object_t* obj)
             }
         }
     }
-    free(obj);
+}
+
+#ifdef BACKGROUND_FREE
+
+/* When more than BACKGROUND_FREE_THRESHOLD objects are freed in one go, the
+ * dead pairs that are left are handed to a background thread so that the
+ * interpreter can continue. The pairs handed off in one round of freeing are
+ * gathered into a single job, so a long list costs one job and not one for
+ * every dead pair that follows the threshold.
+ *
+ * The thread only frees the cells of the pairs that are referenced by nothing
+ * but the dead structure. Every other member, and every number and callable,
+ * may share memory with the interpreter, so it is handed back and dereferenced
+ * the next time the interpreter frees objects. The cells are handed back as a
+ * slab batch because the slab is not locked either.
+ *
+ * Jobs and results are passed in lock-free stacks. The taker always takes the
+ * whole stack so popping has no ABA problem.
+ */
+#define BACKGROUND_FREE_THRESHOLD 4096
+
+typedef struct bg_free_node {
+    struct bg_free_node* next;
+    dynarr_object_ptr_t pairs; /* the dead pairs of the job */
+    /* the result */
+    slab_batch_t cells;
+    unsigned long cell_count;
+    dynarr_object_ptr_t leftovers;
+} bg_free_node_t;
+
+static _Atomic(bg_free_node_t*) bg_free_jobs = NULL;
+static _Atomic(bg_free_node_t*) bg_free_results = NULL;
+static atomic_int bg_free_is_stopping = 0;
+static sem_t bg_free_job_sem;
+static pthread_t bg_free_thread;
+static int bg_free_is_started = 0;
+/* the job that gathers the pairs until it is submitted */
+static bg_free_node_t* bg_free_pending = NULL;
+
+/* counters of background freeing. they are only touched by the interpreter */
+static struct {
+    unsigned long jobs;
+    unsigned long cells;
+    unsigned long leftovers;
+} bg_free_stats = { 0, 0, 0 };
+
+static void
+bg_free_push(_Atomic(bg_free_node_t*) * stack, bg_free_node_t* node)
+{
+    node->next = atomic_load(stack);
+    while (!atomic_compare_exchange_weak(stack, &node->next, node)) { }
+}
+
+/* free the cells of the job's pairs and of the pairs only they can reach */
+static void
+bg_free_do_job(bg_free_node_t* node)
+{
+    /* the pairs of the job are the initial stack */
+    dynarr_object_ptr_t stack = node->pairs;
+    object_t* pair;
+    object_t* members[2];
+    int i;
+    node->cells = (slab_batch_t)SLAB_BATCH_INIT;
+    node->cell_count = 0;
+    node->leftovers = dynarr_object_ptr_new();
+    while (stack.size > 0) {
+        pair = stack.data[--stack.size];
+        members[0] = pair->as.pair.left;
+        members[1] = pair->as.pair.right;
+        for (i = 0; i < 2; i++) {
+            if (members[i] == NULL || IS_SMALL_INT(members[i])
+                || members[i]->is_const) {
+                continue;
+            }
+            /* a count of one is the reference from the dead pair, so no one
+             * else can touch the member */
+            if (members[i]->type == TYPE_PAIR && members[i]->ref_count == 1) {
+                dynarr_object_ptr_append(&stack, &members[i]);
+            } else {
+                dynarr_object_ptr_append(&node->leftovers, &members[i]);
+            }
+        }
+        slab_batch_add(&object_slabs[TYPE_PAIR], &node->cells, pair);
+        node->cell_count++;
+    }
+    dynarr_object_ptr_free(&stack);
+}
+
+static void*
+bg_free_thread_main(void* arg)
+{
+    bg_free_node_t *jobs, *next;
+    int is_stopping;
+    (void)arg;
+    while (1) {
+        sem_wait(&bg_free_job_sem);
+        /* read the flag first so that no job pushed before it is missed */
+        is_stopping = atomic_load(&bg_free_is_stopping);
+        jobs = atomic_exchange(&bg_free_jobs, NULL);
+        if (jobs == NULL && is_stopping) {
+            return NULL;
+        }
+        while (jobs != NULL) {
+            next = jobs->next;
+            bg_free_do_job(jobs);
+            bg_free_push(&bg_free_results, jobs);
+            jobs = next;
+        }
+    }
+}
+
+/* add a dead pair to the pending job. return 0 if it can not be handed to
+ * the background thread */
+static int
+bg_free_hand_off(object_t* pair)
+{
+    if (!global_is_enable_background_free) {
+        return 0;
+    }
+    if (!bg_free_is_started) {
+        if (sem_init(&bg_free_job_sem, 0, 0) != 0
+            || pthread_create(
+                   &bg_free_thread, NULL, bg_free_thread_main, NULL
+               ) != 0) {
+            global_is_enable_background_free = 0;
+            return 0;
+        }
+        bg_free_is_started = 1;
+    }
+    if (bg_free_pending == NULL) {
+        bg_free_pending = malloc(sizeof(bg_free_node_t));
+        if (bg_free_pending == NULL) {
+            return 0;
+        }
+        bg_free_pending->pairs = dynarr_object_ptr_new();
+    }
+    dynarr_object_ptr_append(&bg_free_pending->pairs, &pair);
+    return 1;
+}
+
+/* give the pending job to the background thread */
+static void
+bg_free_submit()
+{
+    if (bg_free_pending == NULL) {
+        return;
+    }
+    bg_free_push(&bg_free_jobs, bg_free_pending);
+    sem_post(&bg_free_job_sem);
+    bg_free_pending = NULL;
+    bg_free_stats.jobs++;
+}
+
+/* take back the cells and the leftovers of the finished jobs */
+static void
+bg_free_collect()
+{
+    bg_free_node_t *results, *next;
+    int i;
+    if (!bg_free_is_started
+        || atomic_load_explicit(&bg_free_results, memory_order_relaxed)
+            == NULL) {
+        return;
+    }
+    results = atomic_exchange(&bg_free_results, NULL);
+    while (results != NULL) {
+        next = results->next;
+        slab_batch_free(&object_slabs[TYPE_PAIR], &results->cells);
+        for (i = 0; i < results->leftovers.size; i++) {
+            object_deref(results->leftovers.data[i]);
+        }
+        bg_free_stats.cells += results->cell_count;
+        bg_free_stats.leftovers += results->leftovers.size;
+        dynarr_object_ptr_free(&results->leftovers);
+        free(results);
+        results = next;
+    }
+}
+
+#endif
+
+/* free the objects in dead_objects and the objects that die with them */
+static void
+object_free_dead_objects()
+{
+    /* one batch for each type because the cells differ in size */
+    slab_batch_t batches[OBJECT_TYPE_NUM];
+    unsigned long freed_count = 0;
+    object_t* obj;
+    int i;
+    for (i = 0; i < OBJECT_TYPE_NUM; i++) {
+        batches[i] = (slab_batch_t)SLAB_BATCH_INIT;
+    }
+    is_freeing_dead_objects = 1;
+    do {
+        while (dead_objects.size > 0) {
+            obj = dead_objects.data[--dead_objects.size];
+#ifdef BACKGROUND_FREE
+            if (freed_count >= BACKGROUND_FREE_THRESHOLD
+                && obj->type == TYPE_PAIR && bg_free_hand_off(obj)) {
+                continue;
+            }
+#endif
+            object_free_members(obj);
+            slab_batch_add(&object_slabs[obj->type], &batches[obj->type], obj);
+            freed_count++;
+        }
+#ifdef BACKGROUND_FREE
+        bg_free_submit();
+        /* the leftovers are pushed into dead_objects if they die */
+        bg_free_collect();
+#endif
+    } while (dead_objects.size > 0);
+    for (i = 0; i < OBJECT_TYPE_NUM; i++) {
+        slab_batch_free(&object_slabs[i], &batches[i]);
+    }
+    is_freeing_dead_objects = 0;
+}
+
+inline void
+object_deref(object_t* obj)
+{
+    if (IS_SMALL_INT(obj)) {
+        return;
+    }
+#ifdef ENABLE_DEBUG_LOG_MORE
+    printf("object_deref: addr=%p, ref_count=%d print: ", obj, obj->ref_count);
+    object_print(obj, '\n');
+    fflush(stdout);
+#endif
+    if (obj->is_const) {
+        return;
+    }
+    if (obj->ref_count != 1) {
+        obj->ref_count--;
+        return;
+    }
+    if (dead_objects.data == NULL) {
+        dead_objects = dynarr_object_ptr_new();
+    }
+    dynarr_object_ptr_append(&dead_objects, &obj);
+    /* the loop is already running in a caller */
+    if (!is_freeing_dead_objects) {
+        object_free_dead_objects();
+    }
+}
+
+/* make the object immortal: it is never counted or freed by deref, so it
+ * can be shared without touching its reference count */
+object_t*
+object_make_immortal(object_t* obj)
+{
+    if (!IS_SMALL_INT(obj)) {
+        obj->is_const = 1;
+    }
+    return obj;
+}
+
+/* free an object made immortal. its members are not freed because they are
+ * immortal objects of their own */
+void
+object_free_immortal(object_t* obj)
+{
+    if (IS_SMALL_INT(obj)) {
+        return;
+    }
+    if (obj->type == TYPE_NUM) {
+        number_free(&obj->as.number);
+    }
+    slab_free(&object_slabs[obj->type], obj);
+}
+
+/* wait for the background thread to free everything handed to it */
+void
+object_wait_background_free()
+{
+#ifdef BACKGROUND_FREE
+    if (!bg_free_is_started) {
+        return;
+    }
+    atomic_store(&bg_free_is_stopping, 1);
+    sem_post(&bg_free_job_sem);
+    pthread_join(bg_free_thread, NULL);
+    sem_destroy(&bg_free_job_sem);
+    /* collect the results once more even if nothing is left to free */
+    object_free_dead_objects();
+    bg_free_is_started = 0;
+    atomic_store(&bg_free_is_stopping, 0);
+#ifdef ENABLE_DEBUG_LOG
+    if (global_is_enable_debug_log) {
+        printf(
+            "background free: jobs=%lu cells=%lu leftovers=%lu\n",
+            bg_free_stats.jobs, bg_free_stats.cells, bg_free_stats.leftovers
+        );
+    }
+#endif
+#endif
 }
 
 inline int
 object_print(const object_t* obj, char end)
 {
     int printed_bytes_count = 0;
-    if (obj->is_error) {
+    if (IS_SMALL_INT(obj)) {
+        number_t n = number_from_i64(SMALL_INT_VALUE(obj));
+        printed_bytes_count = number_print_frac(&n, '\0');
+        number_free(&n);
+    } else if (obj->is_error) {
         printed_bytes_count = printf("[Error]");
     } else if (obj->type == TYPE_NULL) {
         printed_bytes_count = printf("[Null]");
@@ -147,7 +503,10 @@ object_print(const object_t* obj, char end)
 inline int
 object_eq(object_t* a, object_t* b)
 {
-    if (a->type != b->type) {
+    if (IS_SMALL_INT(a) || IS_SMALL_INT(b)) {
+        /* number objects are never small integers */
+        return a == b;
+    } else if (a->type != b->type) {
         return 0;
     } else if (a->type == TYPE_CALL) {
         callable_t *a_func = &a->as.callable, *b_func = &b->as.callable;
@@ -174,7 +533,9 @@ object_eq(object_t* a, object_t* b)
 inline int
 object_to_bool(object_t* obj)
 {
-    if (obj->type == TYPE_NUM) {
+    if (IS_SMALL_INT(obj)) {
+        return SMALL_INT_VALUE(obj) != 0;
+    } else if (obj->type == TYPE_NUM) {
         return obj->as.number.numer.size != 0;
     } else {
         return obj->type != TYPE_NULL;
@@ -1,6 +1,8 @@
 #include "bigint.h"
 #include "number.h"
 #include "token.h"
+#include <stddef.h>
+#include <stdint.h>
 
 #ifndef OBJECT_H
 #define OBJECT_H
@@ -69,14 +71,41 @@ typedef struct object {
 #define object_data_size sizeof(object_data_union)
 #define object_struct_size sizeof(object_t)
 
+/* An object is allocated with the header and only the member of its type,
+ * so a pair takes 24 bytes instead of the size of the whole union. Objects
+ * are never copied as a whole object_t except the static ones. */
+#define OBJECT_HEADER_SIZE offsetof(object_t, as)
+#define OBJECT_SIZE_OF(member_type) (OBJECT_HEADER_SIZE + sizeof(member_type))
+
+/* An integer that fits in a pointer with one bit less is not allocated as an
+ * object. It is stored in the object pointer itself with the lowest bit set,
+ * which is never set in the address of an object. Numbers are made small
+ * integers whenever they can be, so a number object is never one of them. */
+#define SMALL_INT_MIN (INTPTR_MIN >> 1)
+#define SMALL_INT_MAX (INTPTR_MAX >> 1)
+#define IS_SMALL_INT(obj) (((uintptr_t)(obj)) & 1)
+#define SMALL_INT_VALUE(obj) (((intptr_t)(obj)) >> 1)
+#define SMALL_INT_OBJECT(i) ((object_t*)((((uintptr_t)(i)) << 1) | 1))
+#define IS_SMALL_INT_RANGE(i) (SMALL_INT_MIN <= (i) && (i) <= SMALL_INT_MAX)
+
+/* the type and error flag of objects that could be small integers */
+#define OBJ_TYPE(obj) (IS_SMALL_INT(obj) ? TYPE_NUM : (obj)->type)
+#define OBJ_IS_ERROR(obj) (!IS_SMALL_INT(obj) && (obj)->is_error)
+
 extern const object_t* ERR_OBJECT_PTR;
 extern const object_t ERR_OBJECT;
 
 extern const char* OBJ_TYPE_SIG_STR[OBJ_TYPE_SIG_STR_LEN];
 
 extern object_t* object_create(object_type_enum type, object_data_union data);
+extern object_t* object_from_number(number_t number);
+extern object_t* object_renew_number(object_t* obj);
+extern const number_t* object_get_number(const object_t* obj, number_t* buf);
 extern object_t* object_ref(object_t* obj);
 extern void object_deref(object_t* obj);
+extern void object_wait_background_free();
+extern object_t* object_make_immortal(object_t* obj);
+extern void object_free_immortal(object_t* obj);
 extern int object_print(const object_t* obj, char end);
 
 extern int object_eq(object_t* a, object_t* b);
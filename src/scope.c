@@ -0,0 +1,594 @@
+#include "scope.h"
+#include "operators.h"
+#include "syntax_tree.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+
+/* the working state of scope resolution */
+typedef struct resolver {
+    syntax_tree_t* tree;
+    /* is the id code initialized by id code somewhere */
+    char* is_name_code;
+    /* the evaluation order of each node in the body it is in */
+    int* eval_orders;
+    /* the evaluation order of the function maker of each scope in the body
+     * of its enclosing scope, -1 if unknown */
+    int* maker_orders;
+    int order_counter;
+    /* the id code and the scope of the identifiers read in macros */
+    dynarr_int_t macro_read_codes;
+    dynarr_int_t macro_read_scopes;
+} resolver_t;
+
+static int
+scope_find_slot(const scope_t* scope, const int code)
+{
+    int i;
+    for (i = 0; i < scope->slot_codes.size; i++) {
+        if (scope->slot_codes.data[i] == code) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* create the scope of an entry and return its index */
+static int
+scope_new(syntax_tree_t* tree, const int entry_index, const int parent)
+{
+    scope_t scope = {
+        .entry_index = entry_index,
+        .parent = parent,
+        .slot_codes = dynarr_int_new(),
+        .slot_init_orders = dynarr_int_new(),
+        .capture_codes = dynarr_int_new(),
+        .capture_addrs = dynarr_int_new(),
+        .has_closure = 0,
+        .is_dynamic = 0,
+    };
+    dynarr_scope_append(&tree->scopes, &scope);
+    tree->entry_scopes[entry_index] = tree->scopes.size - 1;
+    return tree->scopes.size - 1;
+}
+
+/* give every identifier in the assignee subtree a slot in the scope. the
+ * slots that are new get the init order */
+static void
+define_ids(
+    syntax_tree_t* tree, const int index, const int scope_index,
+    int init_order
+)
+{
+    const token_t* token = &tree->tokens.data[index];
+    scope_t* scope = &tree->scopes.data[scope_index];
+    int slot;
+    if (token->type == TOK_OP) {
+        /* pair unpacking */
+        define_ids(tree, tree->lefts[index], scope_index, init_order);
+        define_ids(tree, tree->rights[index], scope_index, init_order);
+        return;
+    }
+    if (scope_index == ROOT_SCOPE_INDEX) {
+        tree->id_addrs[index] = GLOBAL_ADDR;
+        return;
+    }
+    slot = scope_find_slot(scope, token->code);
+    if (slot == -1) {
+        slot = scope->slot_codes.size;
+        dynarr_int_append(&scope->slot_codes, (int*)&token->code);
+        dynarr_int_append(&scope->slot_init_orders, &init_order);
+    }
+    tree->id_addrs[index] = MAKE_LOCAL_ADDR(SLOT_DEPTH, slot);
+}
+
+/* make every identifier in the assignee subtree be set by its id code */
+static void
+define_name_ids(resolver_t* r, const int index)
+{
+    const token_t* token = &r->tree->tokens.data[index];
+    if (token->type == TOK_OP) {
+        /* pair unpacking */
+        define_name_ids(r, r->tree->lefts[index]);
+        define_name_ids(r, r->tree->rights[index]);
+        return;
+    }
+    r->tree->id_addrs[index] = NAME_ADDR;
+    r->is_name_code[token->code] = 1;
+}
+
+/* create the scopes of functions and give slots to identifiers initialized
+ * in them. identifiers initialized in macros are set by id code */
+static void
+collect_scopes(
+    resolver_t* r, const int index, const int scope_index, const int in_macro
+)
+{
+    syntax_tree_t* tree = r->tree;
+    const token_t* token;
+    int left, right, func_scope_index;
+    if (index == -1) {
+        return;
+    }
+    token = &tree->tokens.data[index];
+    if (token->type != TOK_OP) {
+        return;
+    }
+    left = tree->lefts[index];
+    right = tree->rights[index];
+    switch (token->code) {
+    case OP_MAKE_FUNCT:
+        tree->scopes.data[scope_index].has_closure = 1;
+        /* the scope is already created if the function has argument */
+        func_scope_index = tree->entry_scopes[left];
+        if (func_scope_index == -1) {
+            func_scope_index = scope_new(tree, left, scope_index);
+        }
+        if (in_macro) {
+            tree->scopes.data[func_scope_index].is_dynamic = 1;
+        }
+        collect_scopes(r, left, func_scope_index, 0);
+        return;
+    case OP_MAKE_MACRO:
+        /* macro runs in the frame of its caller */
+        tree->entry_scopes[left] = scope_index;
+        collect_scopes(r, left, scope_index, 1);
+        return;
+    case OP_BIND_ARG:
+        if (tree->tokens.data[right].type == TOK_OP
+            && tree->tokens.data[right].code == OP_MAKE_FUNCT) {
+            /* the argument belongs to the function on the right */
+            func_scope_index
+                = scope_new(tree, tree->lefts[right], scope_index);
+            define_ids(tree, left, func_scope_index, -1);
+        } else {
+            /* the function is only known at run time */
+            define_name_ids(r, left);
+        }
+        collect_scopes(r, right, scope_index, in_macro);
+        return;
+    case OP_ASSIGN:
+        if (in_macro) {
+            define_name_ids(r, left);
+        } else {
+            define_ids(tree, left, scope_index, INT_MAX);
+        }
+        collect_scopes(r, right, scope_index, in_macro);
+        return;
+    default:
+        collect_scopes(r, left, scope_index, in_macro);
+        collect_scopes(r, right, scope_index, in_macro);
+        return;
+    }
+}
+
+/* is the identifier a slot of the scope or any of its enclosing functions */
+static int
+is_slot_in_chain(const syntax_tree_t* tree, const int code, int scope_index)
+{
+    while (scope_index != ROOT_SCOPE_INDEX) {
+        const scope_t* scope = &tree->scopes.data[scope_index];
+        if (scope_find_slot(scope, code) != -1) {
+            return 1;
+        }
+        scope_index = scope->parent;
+    }
+    return 0;
+}
+
+/* if an identifier that is initialized by id code is read in a function but
+ * is not a slot of it or its enclosing functions, it can be in any of their
+ * frames, so they all have to keep what they can see */
+static void
+find_dynamic_scopes(resolver_t* r, const int index, const int scope_index)
+{
+    syntax_tree_t* tree = r->tree;
+    const token_t* token;
+    if (index == -1) {
+        return;
+    }
+    token = &tree->tokens.data[index];
+    if (token->type == TOK_ID) {
+        int cur_scope_index = scope_index;
+        if (!r->is_name_code[token->code]
+            || is_slot_in_chain(tree, token->code, scope_index)) {
+            return;
+        }
+        while (cur_scope_index != ROOT_SCOPE_INDEX) {
+            tree->scopes.data[cur_scope_index].is_dynamic = 1;
+            cur_scope_index = tree->scopes.data[cur_scope_index].parent;
+        }
+        return;
+    }
+    if (token->type != TOK_OP) {
+        return;
+    }
+    switch (token->code) {
+    case OP_MAKE_FUNCT:
+    case OP_MAKE_MACRO:
+        find_dynamic_scopes(
+            r, tree->lefts[index], tree->entry_scopes[tree->lefts[index]]
+        );
+        return;
+    case OP_BIND_ARG:
+    case OP_ASSIGN:
+        find_dynamic_scopes(r, tree->rights[index], scope_index);
+        return;
+    default:
+        find_dynamic_scopes(r, tree->lefts[index], scope_index);
+        find_dynamic_scopes(r, tree->rights[index], scope_index);
+        return;
+    }
+}
+
+/* record the init order of the slots in the assignee subtree */
+static void
+init_slots(resolver_t* r, const int index, const int scope_index)
+{
+    syntax_tree_t* tree = r->tree;
+    const uint32_t addr = tree->id_addrs[index];
+    int* init_order;
+    if (tree->tokens.data[index].type == TOK_OP) {
+        init_slots(r, tree->lefts[index], scope_index);
+        init_slots(r, tree->rights[index], scope_index);
+        return;
+    }
+    if (addr == GLOBAL_ADDR || addr == NAME_ADDR) {
+        return;
+    }
+    init_order = &tree->scopes.data[scope_index]
+                      .slot_init_orders.data[LOCAL_ADDR_SLOT(addr)];
+    if (*init_order == INT_MAX) {
+        *init_order = r->order_counter;
+    }
+}
+
+/* number the nodes of a body in the order they are evaluated, and find when
+ * each slot is always initialized. assignments in the right side of the
+ * conditional operators may not happen so they are not counted */
+static void
+order_body(
+    resolver_t* r, const int index, const int scope_index, const int is_cond
+)
+{
+    syntax_tree_t* tree = r->tree;
+    const token_t* token;
+    int left, right;
+    if (index == -1) {
+        return;
+    }
+    token = &tree->tokens.data[index];
+    left = tree->lefts[index];
+    right = tree->rights[index];
+    if (token->type != TOK_OP) {
+        r->eval_orders[index] = r->order_counter++;
+        return;
+    }
+    switch (token->code) {
+    case OP_MAKE_FUNCT:
+        r->maker_orders[tree->entry_scopes[left]] = r->order_counter;
+        r->eval_orders[index] = r->order_counter++;
+        return;
+    case OP_MAKE_MACRO:
+        r->eval_orders[index] = r->order_counter++;
+        return;
+    case OP_ASSIGN:
+        order_body(r, right, scope_index, is_cond);
+        if (!is_cond) {
+            init_slots(r, left, scope_index);
+        }
+        r->eval_orders[index] = r->order_counter++;
+        return;
+    case OP_BIND_ARG:
+        order_body(r, right, scope_index, is_cond);
+        r->eval_orders[index] = r->order_counter++;
+        return;
+    case OP_COND_AND:
+    case OP_COND_OR:
+        order_body(r, left, scope_index, is_cond);
+        order_body(r, right, scope_index, 1);
+        r->eval_orders[index] = r->order_counter++;
+        return;
+    default:
+        order_body(r, left, scope_index, is_cond);
+        order_body(r, right, scope_index, is_cond);
+        r->eval_orders[index] = r->order_counter++;
+        return;
+    }
+}
+
+/* make the scope capture the identifier at the slot of the scope that is
+ * depth levels out, and return the capture index. the functions in between
+ * capture it too so that it can be passed in when the scope is created */
+static int
+scope_capture(
+    syntax_tree_t* tree, const int scope_index, const int code,
+    const int depth, const int slot
+)
+{
+    scope_t* scope;
+    uint32_t addr;
+    int i;
+    if (depth == 1) {
+        addr = MAKE_LOCAL_ADDR(SLOT_DEPTH, slot);
+    } else {
+        int parent_capture_index = scope_capture(
+            tree, tree->scopes.data[scope_index].parent, code, depth - 1, slot
+        );
+        addr = MAKE_LOCAL_ADDR(CAPTURE_DEPTH, parent_capture_index);
+    }
+    scope = &tree->scopes.data[scope_index];
+    for (i = 0; i < scope->capture_addrs.size; i++) {
+        if ((uint32_t)scope->capture_addrs.data[i] == addr) {
+            return i;
+        }
+    }
+    dynarr_int_append(&scope->capture_codes, (int*)&code);
+    dynarr_int_append(&scope->capture_addrs, (int*)&addr);
+    return scope->capture_addrs.size - 1;
+}
+
+/* resolve the address of an identifier read at the node. a slot is read by
+ * its address only if it is always initialized before the node. a captured
+ * identifier is read by its address only if it is always initialized before
+ * the function that captures it is created. others are read by id code, so
+ * the nearest enclosing function that initializes the identifier is still
+ * captured in case the slot is not initialized yet */
+static uint32_t
+resolve_id(resolver_t* r, const int code, const int scope_index, int index)
+{
+    syntax_tree_t* tree = r->tree;
+    int depth = 1, child_scope_index = scope_index;
+    int cur_scope_index, slot, outer_slot;
+    const scope_t* scope = &tree->scopes.data[scope_index];
+    if (scope_index == ROOT_SCOPE_INDEX) {
+        return GLOBAL_ADDR;
+    }
+    slot = scope_find_slot(scope, code);
+    if (slot != -1
+        && scope->slot_init_orders.data[slot] < r->eval_orders[index]) {
+        return MAKE_LOCAL_ADDR(SLOT_DEPTH, slot);
+    }
+    if (scope->is_dynamic) {
+        return NAME_ADDR;
+    }
+    for (cur_scope_index = scope->parent; cur_scope_index != ROOT_SCOPE_INDEX;
+         cur_scope_index = tree->scopes.data[cur_scope_index].parent) {
+        const scope_t* outer_scope = &tree->scopes.data[cur_scope_index];
+        outer_slot = scope_find_slot(outer_scope, code);
+        if (outer_slot != -1) {
+            int capture_index
+                = scope_capture(tree, scope_index, code, depth, outer_slot);
+            if (slot == -1 && !r->is_name_code[code]
+                && outer_scope->slot_init_orders.data[outer_slot]
+                    < r->maker_orders[child_scope_index]) {
+                return MAKE_LOCAL_ADDR(CAPTURE_DEPTH, capture_index);
+            }
+            return NAME_ADDR;
+        }
+        child_scope_index = cur_scope_index;
+        depth++;
+    }
+    return (slot != -1 || r->is_name_code[code]) ? NAME_ADDR : GLOBAL_ADDR;
+}
+
+/* make the scope capture the nearest identifier of the enclosing functions
+ * if it is not a slot of the scope */
+static void
+capture_nearest(syntax_tree_t* tree, const int scope_index, const int code)
+{
+    int depth = 0, cur_scope_index = scope_index;
+    while (cur_scope_index != ROOT_SCOPE_INDEX) {
+        const scope_t* scope = &tree->scopes.data[cur_scope_index];
+        int slot = scope_find_slot(scope, code);
+        if (slot != -1) {
+            if (depth != 0) {
+                scope_capture(tree, scope_index, code, depth, slot);
+            }
+            return;
+        }
+        cur_scope_index = scope->parent;
+        depth++;
+    }
+}
+
+/* is the scope inside the other scope */
+static int
+is_inner_scope(
+    const syntax_tree_t* tree, int scope_index, const int outer_scope_index
+)
+{
+    while (scope_index != ROOT_SCOPE_INDEX) {
+        scope_index = tree->scopes.data[scope_index].parent;
+        if (scope_index == outer_scope_index) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* a macro can be called in the functions inside the scope it is created in,
+ * so they capture what the macro reads too */
+static void
+capture_macro_reads(resolver_t* r)
+{
+    syntax_tree_t* tree = r->tree;
+    int i, j;
+    for (i = 0; i < r->macro_read_codes.size; i++) {
+        const int macro_scope_index = r->macro_read_scopes.data[i];
+        if (macro_scope_index == ROOT_SCOPE_INDEX
+            || tree->scopes.data[macro_scope_index].is_dynamic) {
+            continue;
+        }
+        for (j = macro_scope_index + 1; j < tree->scopes.size; j++) {
+            if (!tree->scopes.data[j].is_dynamic
+                && is_inner_scope(tree, j, macro_scope_index)) {
+                capture_nearest(tree, j, r->macro_read_codes.data[i]);
+            }
+        }
+    }
+}
+
+/* resolve the address of every identifier that is read. identifiers in
+ * macros are read by id code in the frame of the caller, but they are still
+ * captured by the function the macro is created in */
+static void
+resolve_ids(
+    resolver_t* r, const int index, const int scope_index, const int in_macro
+)
+{
+    syntax_tree_t* tree = r->tree;
+    const token_t* token;
+    if (index == -1) {
+        return;
+    }
+    token = &tree->tokens.data[index];
+    if (token->type == TOK_ID) {
+        tree->id_addrs[index]
+            = resolve_id(r, token->code, scope_index, index);
+        if (in_macro) {
+            tree->id_addrs[index] = NAME_ADDR;
+            dynarr_int_append(&r->macro_read_codes, (int*)&token->code);
+            dynarr_int_append(&r->macro_read_scopes, (int*)&scope_index);
+        }
+        return;
+    }
+    if (token->type != TOK_OP) {
+        return;
+    }
+    switch (token->code) {
+    case OP_MAKE_FUNCT:
+        resolve_ids(
+            r, tree->lefts[index], tree->entry_scopes[tree->lefts[index]], 0
+        );
+        return;
+    case OP_MAKE_MACRO:
+        resolve_ids(
+            r, tree->lefts[index], tree->entry_scopes[tree->lefts[index]], 1
+        );
+        return;
+    case OP_BIND_ARG:
+    case OP_ASSIGN:
+        /* the left side is initialized, not read */
+        resolve_ids(r, tree->rights[index], scope_index, in_macro);
+        return;
+    default:
+        resolve_ids(r, tree->lefts[index], scope_index, in_macro);
+        resolve_ids(r, tree->rights[index], scope_index, in_macro);
+        return;
+    }
+}
+
+/* build the scopes of the tree and resolve the address of every identifier */
+void
+scope_resolve(syntax_tree_t* tree)
+{
+    int i;
+    const int token_size = tree->tokens.size;
+    dynarr_int_t top_indexs = dynarr_int_new();
+    resolver_t r = {
+        .tree = tree,
+        .is_name_code = calloc(tree->max_id_code + 1, sizeof(char)),
+        .eval_orders = malloc(token_size * sizeof(int)),
+        .maker_orders = NULL,
+        .order_counter = 0,
+        .macro_read_codes = dynarr_int_new(),
+        .macro_read_scopes = dynarr_int_new(),
+    };
+    tree->scopes = dynarr_scope_new();
+    tree->entry_scopes = malloc(token_size * sizeof(int));
+    tree->id_addrs = malloc(token_size * sizeof(uint32_t));
+    assert(tree->entry_scopes != NULL && tree->id_addrs != NULL);
+    assert(r.is_name_code != NULL && r.eval_orders != NULL);
+    for (i = 0; i < token_size; i++) {
+        tree->entry_scopes[i] = -1;
+        tree->id_addrs[i] = GLOBAL_ADDR;
+        r.eval_orders[i] = -1;
+    }
+
+    scope_new(tree, tree->root_index, -1);
+    collect_scopes(&r, tree->root_index, ROOT_SCOPE_INDEX, 0);
+    dynarr_int_append(&top_indexs, &tree->root_index);
+
+    /* callables removed by optimization are still compiled, so give them
+     * scopes as if they were in the root */
+    for (i = token_size - 1; i >= 0; i--) {
+        const token_t* token = &tree->tokens.data[i];
+        if (token->type == TOK_OP
+            && (token->code == OP_MAKE_FUNCT || token->code == OP_MAKE_MACRO)
+            && tree->entry_scopes[tree->lefts[i]] == -1) {
+            collect_scopes(&r, i, ROOT_SCOPE_INDEX, 0);
+            dynarr_int_append(&top_indexs, &i);
+        }
+    }
+
+    /* enclosing scopes are always created before the scopes in them */
+    for (i = 0; i < top_indexs.size; i++) {
+        find_dynamic_scopes(&r, top_indexs.data[i], ROOT_SCOPE_INDEX);
+    }
+    for (i = 1; i < tree->scopes.size; i++) {
+        scope_t* scope = &tree->scopes.data[i];
+        if (scope->parent != ROOT_SCOPE_INDEX
+            && tree->scopes.data[scope->parent].is_dynamic) {
+            scope->is_dynamic = 1;
+        }
+    }
+
+    r.maker_orders = malloc(tree->scopes.size * sizeof(int));
+    assert(r.maker_orders != NULL);
+    for (i = 0; i < tree->scopes.size; i++) {
+        r.maker_orders[i] = -1;
+    }
+    for (i = 1; i < tree->scopes.size; i++) {
+        order_body(&r, tree->scopes.data[i].entry_index, i, 0);
+    }
+
+    for (i = 0; i < top_indexs.size; i++) {
+        resolve_ids(&r, top_indexs.data[i], ROOT_SCOPE_INDEX, 0);
+    }
+    capture_macro_reads(&r);
+
+    dynarr_int_free(&top_indexs);
+    dynarr_int_free(&r.macro_read_codes);
+    dynarr_int_free(&r.macro_read_scopes);
+    free(r.is_name_code);
+    free(r.eval_orders);
+    free(r.maker_orders);
+}
+
+/* get the scope that the bytecode of the entry runs in */
+inline const scope_t*
+scope_of_entry(const syntax_tree_t* tree, const int entry_index)
+{
+    return &tree->scopes.data[tree->entry_scopes[entry_index]];
+}
+
+/* get the id code of an address used in the entry */
+int
+scope_get_id_code(
+    const syntax_tree_t* tree, const int entry_index, const uint32_t addr
+)
+{
+    const scope_t* scope = scope_of_entry(tree, entry_index);
+    if (LOCAL_ADDR_DEPTH(addr) == CAPTURE_DEPTH) {
+        return scope->capture_codes.data[LOCAL_ADDR_SLOT(addr)];
+    }
+    return scope->slot_codes.data[LOCAL_ADDR_SLOT(addr)];
+}
+
+void
+scope_free_all(syntax_tree_t* tree)
+{
+    int i;
+    for (i = 0; i < tree->scopes.size; i++) {
+        dynarr_int_free(&tree->scopes.data[i].slot_codes);
+        dynarr_int_free(&tree->scopes.data[i].slot_init_orders);
+        dynarr_int_free(&tree->scopes.data[i].capture_codes);
+        dynarr_int_free(&tree->scopes.data[i].capture_addrs);
+    }
+    dynarr_scope_free(&tree->scopes);
+    free(tree->entry_scopes);
+    free(tree->id_addrs);
+    tree->entry_scopes = NULL;
+    tree->id_addrs = NULL;
+}
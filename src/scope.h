@@ -0,0 +1,74 @@
+#include "utils/dynarr_int.h"
+#include <stdint.h>
+
+#ifndef SCOPE_H
+#define SCOPE_H
+
+typedef struct syntax_tree syntax_tree_t;
+
+/* The lexical scope of the root or a function. Identifiers initialized in the
+ * root are globals. Identifiers initialized in a function, including its
+ * argument, each get a fixed slot in the function's stack section.
+ * Identifiers of the enclosing functions that are used in the function, its
+ * inner functions or its macros are captured when the function is created.
+ *
+ * Macros run in the frame of their caller, and an argument bound to a
+ * function value is only known at run time, so identifiers initialized that
+ * way are set and read by their id code.
+ */
+typedef struct scope {
+    int entry_index; /* the body node of the function or the root index */
+    int parent; /* index of the enclosing scope, -1 for the root */
+    dynarr_int_t slot_codes; /* the id code of each slot */
+    /* the evaluation order in the body after which each slot is always
+     * initialized. -1 for the argument and INT_MAX if not always */
+    dynarr_int_t slot_init_orders;
+    dynarr_int_t capture_codes; /* the id code of each captured identifier */
+    /* the local address of each captured identifier in the enclosing scope */
+    dynarr_int_t capture_addrs;
+    /* does the function create functions. if not, no hole is opened in its
+     * frame and the frame is not needed after it returns */
+    int has_closure;
+    /* is the function created in a macro, or does it read identifiers
+     * initialized by id code in the enclosing functions. if so, it captures
+     * everything that can be seen where it is created and reads identifiers
+     * that are not its slots by id code */
+    int is_dynamic;
+} scope_t;
+
+#define TYPE scope_t
+#define TYPE_NAME scope
+#include "utils/dynarr.tmpl.h"
+#undef TYPE_NAME
+#undef TYPE
+
+/* the root scope is always the first scope */
+#define ROOT_SCOPE_INDEX 0
+
+/* A local address is a depth and an index. Depth 0 is the slot of the
+ * function itself and depth 1 is the captured identifier of the function.
+ * Identifiers that are not initialized in any enclosing function are globals
+ * and addressed by their id code. Identifiers that may not be initialized
+ * when they are read, or that are set in macros, are looked up by their id
+ * code from the frame outward.
+ */
+#define GLOBAL_ADDR ((uint32_t)-1)
+#define NAME_ADDR ((uint32_t)-2)
+#define SLOT_DEPTH 0
+#define CAPTURE_DEPTH 1
+#define MAKE_LOCAL_ADDR(depth, slot) (((uint32_t)(depth) << 24) | (slot))
+#define LOCAL_ADDR_DEPTH(addr) ((addr) >> 24)
+#define LOCAL_ADDR_SLOT(addr) ((addr) & 0xffffff)
+
+extern void scope_resolve(syntax_tree_t* tree);
+
+extern const scope_t*
+scope_of_entry(const syntax_tree_t* tree, const int entry_index);
+
+extern int scope_get_id_code(
+    const syntax_tree_t* tree, const int entry_index, const uint32_t addr
+);
+
+extern void scope_free_all(syntax_tree_t* tree);
+
+#endif
@@ -49,12 +49,16 @@ syntax_tree_create(dynarr_token_t tokens)
     syntax_tree_t tree = {
         .tokens = postfix_tokens,
         .bytecodes = dynarr_bytecode_new(),
+        .line_table = dynarr_bytecode_pos_new(),
         .bytecode_start_index = dynarr_int_new(),
+        .max_stack_sizes = NULL,
         .entry_indexs = dynarr_int_new(),
         .root_index = -1,
         .lefts = NULL,
         .rights = NULL,
         .max_id_code = -1,
+        .entry_scopes = NULL,
+        .id_addrs = NULL,
     };
     dynarr_int_t index_stack = dynarr_int_new();
     int* tree_data = malloc(token_size * sizeof(int) * 3);
@@ -163,7 +167,12 @@ syntax_tree_create(dynarr_token_t tokens)
     }
 #endif
 
-    /* eval literal */
+    /* resolve identifiers */
+
+    scope_resolve(&tree);
+
+    /* eval literal. literals live as long as the tree and are shared by
+     * every evaluation of them, so they are immortal */
 
     tree.literals = calloc(token_size, sizeof(object_t*));
     assert(tree.literals != NULL);
@@ -173,11 +182,8 @@ syntax_tree_create(dynarr_token_t tokens)
             tree.literals[i]
                 = object_ref((object_t*)&RESERVED_OBJS[cur_token->code]);
         } else if (cur_token->type == TOK_NUM) {
-            tree.literals[i] = object_create(
-                TYPE_NUM,
-                (object_data_union) {
-                    .number = number_from_str(cur_token->str),
-                }
+            tree.literals[i] = object_make_immortal(
+                object_from_number(number_from_str(cur_token->str))
             );
         } else if (cur_token->type == TOK_OP && cur_token->code == OP_PAIR) {
             if (global_is_compile) {
@@ -187,15 +193,15 @@ syntax_tree_create(dynarr_token_t tokens)
             object_t* right = tree.literals[tree.rights[i]];
             /* if left and right are all literal, pair can become literal too */
             if (left && right) {
-                tree.literals[i] = object_create(
+                tree.literals[i] = object_make_immortal(object_create(
                     TYPE_PAIR,
                     (object_data_union) {
                         .pair = (pair_t) {
-                            .left = object_ref(left),
-                            .right = object_ref(right),
+                            .left = left,
+                            .right = right,
                         },
                     }
-                );
+                ));
             }
         }
 #ifdef ENABLE_DEBUG_LOG_MORE
@@ -229,19 +235,41 @@ syntax_tree_create(dynarr_token_t tokens)
 
     for (i = 0; i < tree.entry_indexs.size; i++) {
         int entry_index_i = tree.entry_indexs.data[i];
-        dynarr_bytecode_t bc_i = syntax_tree_compile(&tree, entry_index_i);
+        dynarr_bytecode_pos_t line_table_i = dynarr_bytecode_pos_new();
+        dynarr_bytecode_t bc_i
+            = syntax_tree_compile(&tree, entry_index_i, &line_table_i);
         dynarr_int_append(&tree.bytecode_start_index, &tree.bytecodes.size);
         bytecode_array_extend(
-            &bc_i, BOP_RET, 0, tree.tokens.data[entry_index_i].pos
+            &bc_i, &line_table_i, BOP_RET, 0,
+            tree.tokens.data[entry_index_i].pos
         );
         bytecode_array_extend(
-            &bc_i, BOP_NOP, 0, (linecol_t) { .line = -1, .col = -1 }
+            &bc_i, &line_table_i, BOP_NOP, 0,
+            (linecol_t) { .line = -1, .col = -1 }
+        );
+        bytecode_array_concat(
+            &tree.bytecodes, &tree.line_table, &bc_i, &line_table_i
         );
-        dynarr_bytecode_concat(&tree.bytecodes, &bc_i);
         dynarr_bytecode_free(&bc_i);
+        dynarr_bytecode_pos_free(&line_table_i);
     }
     dynarr_int_append(&tree.bytecode_start_index, &tree.bytecodes.size);
 
+    /* find the max operand stack size of each callable body */
+    tree.max_stack_sizes = calloc(token_size, sizeof(int));
+    assert(tree.max_stack_sizes != NULL);
+    for (i = 0; i < tree.entry_indexs.size; i++) {
+        int j, stack_size = 0, stack_size_max = 0;
+        for (j = tree.bytecode_start_index.data[i];
+             j < tree.bytecode_start_index.data[i + 1]; j++) {
+            stack_size += bytecode_stack_diff(tree.bytecodes.data[j].op);
+            if (stack_size > stack_size_max) {
+                stack_size_max = stack_size;
+            }
+        }
+        tree.max_stack_sizes[tree.entry_indexs.data[i]] = stack_size_max;
+    }
+
 #ifdef ENABLE_DEBUG_LOG
     if (global_is_enable_debug_log) {
         printf("final_tree=\n");
@@ -255,7 +283,7 @@ syntax_tree_create(dynarr_token_t tokens)
 int
 syntax_tree_check_semantic(const syntax_tree_t* tree)
 {
-    frame_t* cur_frame = frame_new(NULL);
+    frame_t* cur_frame = frame_new(tree->max_id_code);
     tree_preorder_iterator_t tree_iter = syntax_tree_iter_init(tree, -1);
     token_t* cur_token = syntax_tree_iter_get(&tree_iter);
     dynarr_int_t func_depth_stack = dynarr_int_new();
@@ -276,7 +304,7 @@ syntax_tree_check_semantic(const syntax_tree_t* tree)
             if (cur_depth <= cur_func_depth) {
                 /* if we left a function */
                 dynarr_int_pop(&func_depth_stack);
-                frame_pop_stack(cur_frame);
+                cur_frame = frame_leave(cur_frame);
             }
             if (cur_token->code == OP_ASSIGN) {
                 /* check assign rule */
@@ -286,7 +314,7 @@ syntax_tree_check_semantic(const syntax_tree_t* tree)
                 is_passed = check_bind_arg_rule(tree, cur_frame, cur_index);
             } else if (cur_token->code == OP_MAKE_FUNCT) {
                 /* walk into a function */
-                frame_push_stack(cur_frame, cur_index);
+                cur_frame = frame_enter(cur_frame, cur_index);
                 dynarr_int_append(&func_depth_stack, &cur_depth);
             }
         }
@@ -316,12 +344,19 @@ syntax_tree_optimatize(syntax_tree_t* tree)
     optimize_remove_no_side_effect_expr(tree);
 }
 
+/* compile the subtree into bytecodes and write their positions into
+ * line_table */
 dynarr_bytecode_t
-syntax_tree_compile(const syntax_tree_t* tree, const int root_index)
+syntax_tree_compile(
+    const syntax_tree_t* tree, const int root_index,
+    dynarr_bytecode_pos_t* line_table
+)
 {
     dynarr_bytecode_t output = dynarr_bytecode_new();
     dynarr_bytecode_t left_code;
     dynarr_bytecode_t right_code;
+    dynarr_bytecode_pos_t left_line_table;
+    dynarr_bytecode_pos_t right_line_table;
     token_t cur_token = tree->tokens.data[root_index];
     linecol_t cur_pos = cur_token.pos;
     bytecode_op_code_enum bop_code;
@@ -337,90 +372,142 @@ syntax_tree_compile(const syntax_tree_t* tree, const int root_index)
 #endif
 
     if (tree->literals[root_index] != NULL) {
-        bytecode_array_extend(&output, BOP_PUSH_LIT, root_index, cur_pos);
+        bytecode_array_extend(
+            &output, line_table, BOP_PUSH_LIT, root_index, cur_pos
+        );
         return output;
     } else if (cur_token.type == TOK_ID) {
-        bytecode_array_extend(&output, BOP_FGET, cur_token.code, cur_pos);
+        uint32_t addr = tree->id_addrs[root_index];
+        if (addr == GLOBAL_ADDR) {
+            bytecode_array_extend(
+                &output, line_table, BOP_FGET_GLOBAL, cur_token.code, cur_pos
+            );
+        } else if (addr == NAME_ADDR) {
+            bytecode_array_extend(
+                &output, line_table, BOP_FGET, cur_token.code, cur_pos
+            );
+        } else {
+            bytecode_array_extend(
+                &output, line_table, BOP_FGET_LOCAL, addr, cur_pos
+            );
+        }
         return output;
     }
 
     bop_code = op_to_bop_code(cur_token.code);
     left_index = tree->lefts[root_index];
     right_index = tree->rights[root_index];
+    left_line_table = dynarr_bytecode_pos_new();
+    right_line_table = dynarr_bytecode_pos_new();
 
     switch (cur_token.code) {
     case OP_MAKE_FUNCT:
     case OP_MAKE_MACRO:
-        bytecode_array_extend(&output, bop_code, left_index, cur_pos);
+        bytecode_array_extend(
+            &output, line_table, bop_code, left_index, cur_pos
+        );
         break;
     case OP_ASSIGN:
-        right_code = syntax_tree_compile(tree, right_index);
-        dynarr_bytecode_concat(&output, &right_code);
+        right_code = syntax_tree_compile(tree, right_index, &right_line_table);
+        bytecode_array_concat(
+            &output, line_table, &right_code, &right_line_table
+        );
         dynarr_bytecode_free(&right_code);
         if (tree->tokens.data[left_index].type == TOK_OP) {
             /* is pair unpacking */
             bytecode_array_extend(
-                &output, BOP_FSET_UNPACK, left_index, cur_pos
+                &output, line_table, BOP_FSET_UNPACK, left_index, cur_pos
+            );
+        } else if (tree->id_addrs[left_index] == GLOBAL_ADDR) {
+            bytecode_array_extend(
+                &output, line_table, BOP_FSET_GLOBAL,
+                tree->tokens.data[left_index].code, cur_pos
+            );
+        } else if (tree->id_addrs[left_index] == NAME_ADDR) {
+            bytecode_array_extend(
+                &output, line_table, BOP_FSET,
+                tree->tokens.data[left_index].code, cur_pos
             );
         } else {
             bytecode_array_extend(
-                &output, BOP_FSET, tree->tokens.data[left_index].code,
-                cur_pos
+                &output, line_table, BOP_FSET_LOCAL,
+                tree->id_addrs[left_index], cur_pos
             );
         }
         break;
     case OP_BIND_ARG:
-        right_code = syntax_tree_compile(tree, right_index);
-        dynarr_bytecode_concat(&output, &right_code);
+        right_code = syntax_tree_compile(tree, right_index, &right_line_table);
+        bytecode_array_concat(
+            &output, line_table, &right_code, &right_line_table
+        );
         dynarr_bytecode_free(&right_code);
-        bytecode_array_extend(&output, bop_code, left_index, cur_pos);
+        bytecode_array_extend(
+            &output, line_table, bop_code, left_index, cur_pos
+        );
         break;
     case OP_COND_AND:
-        left_code = syntax_tree_compile(tree, left_index);
-        right_code = syntax_tree_compile(tree, right_index);
-        dynarr_bytecode_concat(&output, &left_code);
+        left_code = syntax_tree_compile(tree, left_index, &left_line_table);
+        right_code = syntax_tree_compile(tree, right_index, &right_line_table);
+        bytecode_array_concat(
+            &output, line_table, &left_code, &left_line_table
+        );
         bytecode_array_extend(
-            &output, BOP_BF_OR_POP, right_code.size, cur_pos
+            &output, line_table, BOP_BF_OR_POP, right_code.size, cur_pos
+        );
+        bytecode_array_concat(
+            &output, line_table, &right_code, &right_line_table
         );
-        dynarr_bytecode_concat(&output, &right_code);
         dynarr_bytecode_free(&left_code);
         dynarr_bytecode_free(&right_code);
         break;
     case OP_COND_OR:
-        left_code = syntax_tree_compile(tree, left_index);
-        right_code = syntax_tree_compile(tree, right_index);
-        dynarr_bytecode_concat(&output, &left_code);
+        left_code = syntax_tree_compile(tree, left_index, &left_line_table);
+        right_code = syntax_tree_compile(tree, right_index, &right_line_table);
+        bytecode_array_concat(
+            &output, line_table, &left_code, &left_line_table
+        );
         bytecode_array_extend(
-            &output, BOP_BT_OR_POP, right_code.size, cur_pos
+            &output, line_table, BOP_BT_OR_POP, right_code.size, cur_pos
+        );
+        bytecode_array_concat(
+            &output, line_table, &right_code, &right_line_table
         );
-        dynarr_bytecode_concat(&output, &right_code);
         dynarr_bytecode_free(&left_code);
         dynarr_bytecode_free(&right_code);
         break;
 
     case OP_EXPRSEP:
-        left_code = syntax_tree_compile(tree, left_index);
-        right_code = syntax_tree_compile(tree, right_index);
-        dynarr_bytecode_concat(&output, &left_code);
-        bytecode_array_extend(&output, BOP_POP, 0, cur_pos);
-        dynarr_bytecode_concat(&output, &right_code);
+        left_code = syntax_tree_compile(tree, left_index, &left_line_table);
+        right_code = syntax_tree_compile(tree, right_index, &right_line_table);
+        bytecode_array_concat(
+            &output, line_table, &left_code, &left_line_table
+        );
+        bytecode_array_extend(&output, line_table, BOP_POP, 0, cur_pos);
+        bytecode_array_concat(
+            &output, line_table, &right_code, &right_line_table
+        );
         dynarr_bytecode_free(&left_code);
         dynarr_bytecode_free(&right_code);
         break;
     default:
-        left_code = syntax_tree_compile(tree, left_index);
+        left_code = syntax_tree_compile(tree, left_index, &left_line_table);
+        bytecode_array_concat(
+            &output, line_table, &left_code, &left_line_table
+        );
+        dynarr_bytecode_free(&left_code);
         if (right_index != -1) {
-            right_code = syntax_tree_compile(tree, right_index);
-            dynarr_bytecode_concat(&output, &left_code);
-            dynarr_bytecode_concat(&output, &right_code);
+            right_code
+                = syntax_tree_compile(tree, right_index, &right_line_table);
+            bytecode_array_concat(
+                &output, line_table, &right_code, &right_line_table
+            );
             dynarr_bytecode_free(&right_code);
-        } else {
-            dynarr_bytecode_concat(&output, &left_code);
         }
-        dynarr_bytecode_free(&left_code);
-        bytecode_array_extend(&output, bop_code, 0, cur_pos);
+        bytecode_array_extend(&output, line_table, bop_code, 0, cur_pos);
         break;
     };
+    dynarr_bytecode_pos_free(&left_line_table);
+    dynarr_bytecode_pos_free(&right_line_table);
     return output;
 }
 
@@ -449,6 +536,14 @@ syntax_tree_get_bytecode_start_index(
     return tree->bytecode_start_index.data[found_bytecode_start_index];
 }
 
+linecol_t
+syntax_tree_get_bytecode_pos(
+    const syntax_tree_t* tree, const int bytecode_index
+)
+{
+    return bytecode_pos_lookup(&tree->line_table, bytecode_index);
+}
+
 inline void
 syntax_tree_free(syntax_tree_t* tree)
 {
@@ -467,7 +562,7 @@ syntax_tree_free(syntax_tree_t* tree)
             );
             object_print(tree->literals[i], '\n');
 #endif
-            object_deref(tree->literals[i]);
+            object_free_immortal(tree->literals[i]);
         }
     }
     free(tree->literals);
@@ -478,11 +573,14 @@ syntax_tree_free(syntax_tree_t* tree)
      * head so only need to free left */
     free(tree->lefts);
     free(tree->id_code_str_map);
+    scope_free_all(tree);
 
     /* bytecodes */
     dynarr_bytecode_free(&tree->bytecodes);
+    dynarr_bytecode_pos_free(&tree->line_table);
     dynarr_int_free(&tree->entry_indexs);
     dynarr_int_free(&tree->bytecode_start_index);
+    free(tree->max_stack_sizes);
 }
 
 void
@@ -535,10 +633,20 @@ syntax_tree_print(const syntax_tree_t* tree)
         printf("Bytecode of node %d\n", tree->entry_indexs.data[i]);
         for (j = bc_start; j < bc_end; j++) {
             bytecode_t bc = tree->bytecodes.data[j];
-            printf("%4u: ", j);
+            linecol_t pos = bytecode_pos_lookup(&tree->line_table, j);
+            printf("%4u: (%3d,%3d) ", j, pos.line, pos.col);
             bytecode_print(bc);
-            if (bc.op == BOP_FGET || bc.op == BOP_FSET) {
+            if (bc.op == BOP_FGET_GLOBAL || bc.op == BOP_FSET_GLOBAL
+                || bc.op == BOP_FGET || bc.op == BOP_FSET) {
                 printf(" (\"%s\")", tree->id_code_str_map[bc.arg]);
+            } else if (bc.op == BOP_FGET_LOCAL || bc.op == BOP_FSET_LOCAL) {
+                int code = scope_get_id_code(
+                    tree, tree->entry_indexs.data[i], bc.arg
+                );
+                printf(
+                    " (depth %u slot %u \"%s\")", LOCAL_ADDR_DEPTH(bc.arg),
+                    LOCAL_ADDR_SLOT(bc.arg), tree->id_code_str_map[code]
+                );
             } else if (
                 bc.op == BOP_BF_OR_POP || bc.op == BOP_BT_OR_POP
             ) {
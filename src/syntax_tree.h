@@ -1,4 +1,5 @@
 #include "bytecode.h"
+#include "scope.h"
 #include "token.h"
 #include "utils/dynarr_int.h"
 
@@ -11,14 +12,20 @@ typedef struct syntax_tree {
     dynarr_token_t tokens;
     object_t** literals;
     dynarr_bytecode_t bytecodes;
+    /* source positions of the bytecodes */
+    dynarr_bytecode_pos_t line_table;
     /* sorted array of index of nodes that can be called to */
     dynarr_int_t entry_indexs;
     dynarr_int_t bytecode_start_index;
+    int* max_stack_sizes; /* max operand stack size of each callable body */
     int root_index; /* index of the root node */
     int* lefts; /* index of left child, -1 of none */
     int* rights; /* index of right child, -1 of none */
     int max_id_code; /* number of ids in tree */
     const char** id_code_str_map; /* map of id's code to their name string */
+    dynarr_scope_t scopes; /* lexical scopes of root and functions */
+    int* entry_scopes; /* index of scope that each callable body runs in */
+    uint32_t* id_addrs; /* resolved address of each identifier node */
 } syntax_tree_t;
 
 extern syntax_tree_t syntax_tree_create(dynarr_token_t tokens);
@@ -27,13 +34,19 @@ extern int syntax_tree_check_semantic(const syntax_tree_t* tree);
 
 extern void syntax_tree_optimatize(syntax_tree_t* tree);
 
-extern dynarr_bytecode_t
-syntax_tree_compile(const syntax_tree_t* tree, const int root_index);
+extern dynarr_bytecode_t syntax_tree_compile(
+    const syntax_tree_t* tree, const int root_index,
+    dynarr_bytecode_pos_t* line_table
+);
 
 extern int syntax_tree_get_bytecode_start_index(
     const syntax_tree_t* tree, const int node_index
 );
 
+extern linecol_t syntax_tree_get_bytecode_pos(
+    const syntax_tree_t* tree, const int bytecode_index
+);
+
 extern void syntax_tree_free(syntax_tree_t* tree);
 
 extern void syntax_tree_print(const syntax_tree_t* tree);
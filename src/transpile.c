@@ -82,11 +82,15 @@ transpile_literal(object_t* literal_object)
     char* buffer = malloc(LITERAL_BUFFER_SIZE + 1);
     char* tmp_cstr;
     dynarr_char_t tmp_str;
+    number_t number_buf;
 
-    if (literal_object->type == TYPE_NUM) {
-        tmp_str = number_to_dec_string(
-            &literal_object->as.number, NUMBER_PRECISION
-        );
+    if (OBJ_TYPE(literal_object) == TYPE_NUM) {
+        const number_t* number
+            = object_get_number(literal_object, &number_buf);
+        tmp_str = number_to_dec_string(number, NUMBER_PRECISION);
+        if (number == &number_buf) {
+            number_free(&number_buf);
+        }
         tmp_cstr = dynarr_char_to_str(&tmp_str);
         assert(tmp_cstr);
         snprintf(buffer, LITERAL_BUFFER_SIZE, "(from_number(%s))", tmp_cstr);
@@ -110,27 +114,32 @@ transpile_literal(object_t* literal_object)
 char*
 transpile_bytecode(
     syntax_tree_t* tree, bytecode_t bc, size_t bc_index, int top_index,
-    int reg_arg
+    int entry_index
 )
 {
     static char buffer[BYTECODE_BUFFER_SIZE];
     char* tmp_buffer;
     char* tmplt;
+    int code;
     buffer[0] = '\0';
 
     switch (bc.op) {
     case BOP_NOP:
         break;
     case BOP_PUSH_LIT:
-        reg_arg |= bc.arg;
         tmplt = "inst_%d:\n    s_%d = %s; // PUSH_LITERAL\n";
-        tmp_buffer = transpile_literal(tree->literals[reg_arg]);
+        tmp_buffer = transpile_literal(tree->literals[bc.arg]);
         sprintf(buffer, tmplt, bc_index, top_index + 1, tmp_buffer);
         free(tmp_buffer);
         tmp_buffer = NULL;
         break;
+    case BOP_FGET_LOCAL:
+    case BOP_FGET_GLOBAL:
     case BOP_FGET:
-        reg_arg |= bc.arg;
+        /* the transpiled frame looks up identifiers by id code */
+        code = (bc.op != BOP_FGET_LOCAL)
+            ? (int)bc.arg
+            : scope_get_id_code(tree, entry_index, bc.arg);
         tmplt = "inst_%d:\n"
                 "    s_%d = frame_get(FRAME, %d); // FRAME_GET\n"
                 "    if (!s_%d) {\n"
@@ -139,24 +148,27 @@ transpile_bytecode(
                 "    }\n";
         snprintf(
             buffer, BYTECODE_BUFFER_SIZE, tmplt, bc_index, top_index + 1,
-            reg_arg, top_index + 1, tree->id_code_str_map[reg_arg]
+            code, top_index + 1, tree->id_code_str_map[code]
         );
         break;
+    case BOP_FSET_LOCAL:
+    case BOP_FSET_GLOBAL:
     case BOP_FSET:
-        reg_arg |= bc.arg;
+        code = (bc.op != BOP_FSET_LOCAL)
+            ? (int)bc.arg
+            : scope_get_id_code(tree, entry_index, bc.arg);
         tmplt = "inst_%d:\n"
                 "    frame_set(FRAME, %d, s_%d); // FRAME_SET\n";
         snprintf(
-            buffer, BYTECODE_BUFFER_SIZE, tmplt, bc_index, reg_arg, top_index
+            buffer, BYTECODE_BUFFER_SIZE, tmplt, bc_index, code, top_index
         );
         break;
     case BOP_FSET_UNPACK:
-        reg_arg |= bc.arg;
         tmplt = "inst_%d:\n"
                 "    object_t* s_%d_%d = s_%d; // FRAME_SET_UNPACK\n%s";
-        tmp_buffer = transpile_frame_set_unpack(tree, top_index, reg_arg);
+        tmp_buffer = transpile_frame_set_unpack(tree, top_index, bc.arg);
         snprintf(
-            buffer, BYTECODE_BUFFER_SIZE, tmplt, bc_index, top_index, reg_arg,
+            buffer, BYTECODE_BUFFER_SIZE, tmplt, bc_index, top_index, bc.arg,
             top_index, tmp_buffer
         );
         free(tmp_buffer);
@@ -183,9 +195,8 @@ transpile_bytecode(
     //         object_deref(tmp);
     //         tmp = NULL;
     //     } else {
-    //         reg_arg |= bc.arg;
     //         /* already account for the +1 before exec */
-    //         regs->insp += regs->arg;
+    //         regs->insp += bc.arg;
     //     }
     //     break;
     // case BOP_BT_OR_POP:
@@ -195,13 +206,11 @@ transpile_bytecode(
     //         object_deref(tmp);
     //         tmp = NULL;
     //     } else {
-    //         reg_arg |= bc.arg;
     //         /* already account for the +1 before exec */
-    //         regs->insp += regs->arg;
+    //         regs->insp += bc.arg;
     //     }
     //     break;
     // case BOP_MAKE_FUNCT:
-    //     reg_arg |= bc.arg;
     //     {
     //         tmp = object_create(
     //             TYPE_CALL,
@@ -209,7 +218,7 @@ transpile_bytecode(
     //                 .is_macro = 0,
     //                 .builtin_name = NOT_BUILTIN_FUNC,
     //                 .arg_subtree_index = -1,
-    //                 .index = regs->arg,
+    //                 .index = bc.arg,
     //                 /* function owns a deep copy of frame it created
     //                 under */ .init_frame = frame_copy(cur_frame),
     //             }
@@ -218,14 +227,13 @@ transpile_bytecode(
     //     dynarr_object_ptr_append(stack, &tmp);
     //     break;
     // case BOP_MAKE_MACRO:
-    //     reg_arg |= bc.arg;
     //     tmp = object_create(
     //         TYPE_CALL,
     //         (object_data_union)(callable_t) {
     //             .is_macro = 1,
     //             .builtin_name = NOT_BUILTIN_FUNC,
     //             .arg_subtree_index = -1,
-    //             .index = regs->arg,
+    //             .index = bc.arg,
     //             /* macro does not have frame */
     //             .init_frame = NULL,
     //         }
@@ -466,8 +474,7 @@ transpile_bytecode(
     //         regs->errf = 1;
     //         break;
     //     }
-    //     reg_arg |= bc.arg;
-    //     tmp->as.callable.arg_subtree_index = regs->arg;
+    //     tmp->as.callable.arg_subtree_index = bc.arg;
     //     break;
     // case BOP_COND_PGET:
     //     if (pop_lr_check(stack, bc, &left, &right, ANY_TYPE, TYPE_PAIR)) {
@@ -509,7 +516,9 @@ transpile_bytecode(
             ERR_MSG_BUF, "transpile_bytecode: bad bytecode: %d,%d\n", bc.op,
             bc.arg
         );
-        print_runtime_error(bc.pos, ERR_MSG_BUF);
+        print_runtime_error(
+            syntax_tree_get_bytecode_pos(tree, bc_index), ERR_MSG_BUF
+        );
         exit(RUNTIME_ERR_CODE);
     }
     return buffer;
@@ -529,7 +538,6 @@ transpile_bytecode_section(
 
     int stack_size = 0;
     int stack_size_max = 0;
-    size_t reg_arg = 0;
 
     int i;
     int bc_count = bc_end - bc_start;
@@ -582,31 +590,27 @@ transpile_bytecode_section(
     stack_size = 0;
     for (i = 0; i < bc_count; i++) {
         bytecode_t bc = tree->bytecodes.data[bc_start + i];
-        if (bc.op == BOP_EXTEND_ARG) {
-            reg_arg += (bc.arg << 8 | bc.arg) << 8;
-        } else {
+        const char* bc_code_cstr;
 #ifdef ENABLE_DEBUG_LOG
-            if (global_is_enable_debug_log) {
-                printf("// bytecode: ");
-                bytecode_print(bc);
-                printf("\n");
-                printf("// stack_size: %d\n", stack_size);
-            }
+        if (global_is_enable_debug_log) {
+            printf("// bytecode: ");
+            bytecode_print(bc);
+            printf("\n");
+            printf("// stack_size: %d\n", stack_size);
+        }
 #endif
-            const char* bc_code_cstr = transpile_bytecode(
-                tree, bc, bc_start + i, stack_size - 1, reg_arg
-            );
-            stack_size += bytecode_stack_diff(bc.op);
+        bc_code_cstr = transpile_bytecode(
+            tree, bc, bc_start + i, stack_size - 1, entry_index
+        );
+        stack_size += bytecode_stack_diff(bc.op);
 
 #ifdef ENABLE_DEBUG_LOG
-            if (global_is_enable_debug_log) {
-                printf(bc_code_cstr);
-                printf("// --------\n");
-            }
-#endif
-            write(out_fd, bc_code_cstr, strlen(bc_code_cstr));
-            reg_arg = 0;
+        if (global_is_enable_debug_log) {
+            printf(bc_code_cstr);
+            printf("// --------\n");
         }
+#endif
+        write(out_fd, bc_code_cstr, strlen(bc_code_cstr));
     }
 
     /* render function end */
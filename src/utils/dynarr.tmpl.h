@@ -104,6 +104,21 @@ RENDER(_NAME, _append)(
     x->size++;
 };
 
+/* make sure the array has space for n more elements */
+static inline void
+RENDER(_NAME, _reserve)(
+    RENDER(_NAME, _t) * x, const int n
+)
+{
+    if (x->size + n <= x->cap) {
+        return;
+    }
+    while (x->size + n > x->cap) {
+        x->cap *= 2;
+    }
+    x->data = realloc(x->data, sizeof(TYPE) * x->cap);
+}
+
 #endif
 
 static inline void
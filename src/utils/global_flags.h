@@ -1,2 +1,3 @@
 extern int global_is_enable_debug_log;
 extern int global_is_compile;
+extern int global_is_enable_background_free;
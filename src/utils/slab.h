@@ -0,0 +1,130 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef SLAB_H
+#define SLAB_H
+
+/* A slab hands out cells of one fixed size. Cells are carved from chunks
+ * allocated in bulk and a freed cell is pushed onto a free list so that the
+ * next allocation of the same size reuses it without calling malloc. Chunks
+ * are never returned to the system.
+ *
+ * The interpreter runs in one thread so the free list is not locked.
+ */
+typedef struct slab_cell {
+    struct slab_cell* next;
+} slab_cell_t;
+
+typedef struct slab {
+    unsigned long cell_size;
+    unsigned long chunk_cells;
+    slab_cell_t* free_list;
+    /* the uncarved part of the newest chunk */
+    char* chunk_ptr;
+    char* chunk_end;
+} slab_t;
+
+/* the initializer of a slab of cells of the size */
+#define SLAB_INIT_SIZE(size, cells)                                            \
+    {                                                                          \
+        .cell_size = (size) < sizeof(slab_cell_t) ? sizeof(slab_cell_t)        \
+                                                  : (size),                    \
+        .chunk_cells = (cells),                                                \
+        .free_list = NULL,                                                     \
+        .chunk_ptr = NULL,                                                     \
+        .chunk_end = NULL,                                                     \
+    }
+
+/* the initializer of a slab of the type */
+#define SLAB_INIT(type, cells) SLAB_INIT_SIZE(sizeof(type), cells)
+
+/* the byte that freed cells are filled with in debug build so that reading
+ * a freed object is noticeable */
+#define SLAB_POISON_BYTE 0xdd
+
+#ifndef MEMCHECK_H
+
+static inline void*
+slab_alloc(slab_t* slab)
+{
+    void* cell;
+    if (slab->free_list != NULL) {
+        cell = slab->free_list;
+        slab->free_list = slab->free_list->next;
+        return cell;
+    }
+    if (slab->chunk_ptr == slab->chunk_end) {
+        unsigned long chunk_size = slab->cell_size * slab->chunk_cells;
+        slab->chunk_ptr = malloc(chunk_size);
+        assert(slab->chunk_ptr != NULL);
+        slab->chunk_end = slab->chunk_ptr + chunk_size;
+    }
+    cell = slab->chunk_ptr;
+    slab->chunk_ptr += slab->cell_size;
+    return cell;
+}
+
+static inline void
+slab_free(slab_t* slab, void* cell)
+{
+#ifdef ENABLE_DEBUG_LOG
+    memset(cell, SLAB_POISON_BYTE, slab->cell_size);
+#endif
+    ((slab_cell_t*)cell)->next = slab->free_list;
+    slab->free_list = cell;
+}
+
+/* cells freed in a batch are linked up first and given back to the slab at
+ * once with slab_batch_free */
+typedef struct slab_batch {
+    slab_cell_t* first;
+    slab_cell_t* last;
+} slab_batch_t;
+
+#define SLAB_BATCH_INIT { .first = NULL, .last = NULL }
+
+static inline void
+slab_batch_add(slab_t* slab, slab_batch_t* batch, void* cell)
+{
+#ifdef ENABLE_DEBUG_LOG
+    memset(cell, SLAB_POISON_BYTE, slab->cell_size);
+#else
+    (void)slab;
+#endif
+    ((slab_cell_t*)cell)->next = batch->first;
+    batch->first = cell;
+    if (batch->last == NULL) {
+        batch->last = cell;
+    }
+}
+
+static inline void
+slab_batch_free(slab_t* slab, slab_batch_t* batch)
+{
+    if (batch->first == NULL) {
+        return;
+    }
+    batch->last->next = slab->free_list;
+    slab->free_list = batch->first;
+    batch->first = batch->last = NULL;
+}
+
+#else
+
+/* every cell is a malloc so that memcheck can track each of them */
+#define slab_alloc(slab) malloc((slab)->cell_size)
+#define slab_free(slab, cell) free(cell)
+
+typedef struct slab_batch {
+    int unused;
+} slab_batch_t;
+
+#define SLAB_BATCH_INIT { .unused = 0 }
+#define slab_batch_add(slab, batch, cell) free(cell)
+#define slab_batch_free(slab, batch)
+
+#endif
+
+#endif
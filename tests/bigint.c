@@ -2,6 +2,26 @@
 #include "assert.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* a bigint of n pseudo-random 64-bit digits */
+static bigint_t
+random_bigint(int n, unsigned long long seed)
+{
+    int i, bits = n * 64;
+    char* str = malloc(bits + 3);
+    bigint_t x;
+    strcpy(str, "0b1");
+    for (i = 3; i < bits + 2; i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        str[i] = '0' + (seed >> 63);
+    }
+    str[i] = '\0';
+    x = bi_from_str(str);
+    free(str);
+    return x;
+}
 
 int
 main()
@@ -153,6 +173,109 @@ main()
     print_bi_dec(&result, '\n');
     assert(bi_eq(&result, &amodb));
 
+    /* the remainder has the sign of the divisor, also when |a| < |b| */
+    bigint_t n1 = bi_from_str("-1"), n3 = bi_from_str("-3");
+    bigint_t p3 = bi_from_str("3");
+    bigint_t m31 = bi_from_str("2147483650");
+    bigint_t m62 = bi_from_str("4611686018427387900");
+    bigint_t n62 = bi_from_str("-4611686018427387900");
+    bigint_t n1modm31 = bi_from_str("2147483649");
+    bigint_t n3modm62 = bi_from_str("4611686018427387897");
+    bigint_t p3modn62 = bi_from_str("-4611686018427387897");
+    bigint_t n3modn62 = bi_from_str("-3");
+    result = bi_mod(&n1, &m31);
+    assert(bi_eq(&result, &n1modm31));
+    result = bi_mod(&n3, &m62);
+    assert(bi_eq(&result, &n3modm62));
+    result = bi_mod(&p3, &n62);
+    assert(bi_eq(&result, &p3modn62));
+    result = bi_mod(&n3, &n62);
+    assert(bi_eq(&result, &n3modn62));
+    result = bi_mod(&p3, &m62);
+    assert(bi_eq(&result, &p3));
+    /* -(i + 12) % j = j - 24, i + 12 % -j = 24 - j */
+    bigint_t i12 = bi_add(&i, &imodj);
+    i12.sign = 1;
+    bigint_t j24 = bi_from_str("18446744073709551590");
+    result = bi_mod(&i12, &j);
+    assert(bi_eq(&result, &j24));
+    i12.sign = 0;
+    j.sign = 1;
+    j24.sign = 1;
+    result = bi_mod(&i12, &j);
+    assert(bi_eq(&result, &j24));
+    j.sign = 0;
+
+    /* gcd and exact division */
+    result = bi_gcd(&c, &d);
+    printf("gcd(");
+    print_bi_dec(&c, '\0');
+    printf(", ");
+    print_bi_dec(&d, '\0');
+    puts(") = ");
+    print_bi_dec(&result, '\n');
+    bigint_t cgd = bi_from_str("900000000090000000009");
+    assert(bi_eq(&result, &cgd));
+
+    /* consecutive fibonacci numbers take the most euclidean steps */
+    bigint_t fib_199
+        = bi_from_str("280571172992510140037611932413038677189525");
+    bigint_t fib_198
+        = bi_from_str("173402521172797813159685037284371942044301");
+    result = bi_gcd(&fib_199, &fib_198);
+    assert(bi_eq(&result, &one));
+
+    /* (2^200 - 1)(2^130 - 1) and (2^300 - 1)(2^130 - 1) 2^70 */
+    bigint_t k = bi_from_str(
+        "2187250724783011924372502227117621365351562492848953446150227283188144"
+        "152842999866731300657114906625"
+    );
+    bigint_t l = bi_from_str(
+        "3273390607896141870013189696827599152214237138438304384257932539965021"
+        "5152886418559531879711713618469370474265438806196219478262505169877393"
+        "48402176000"
+    );
+    bigint_t kgl = bi_from_str(
+        "1725436586697640946858688965567895233643825838588514910959407279898625"
+    );
+    bigint_t kdkgl = bi_from_str("1267650600228229401496703205377");
+    result = bi_gcd(&k, &l);
+    assert(bi_eq(&result, &kgl));
+    result = bi_gcd(&l, &k);
+    assert(bi_eq(&result, &kgl));
+    result = bi_divexact(&k, &kgl);
+    assert(bi_eq(&result, &kdkgl));
+    result = bi_divexact(&l, &h);
+    bigint_t ldh = bi_div(&l, &h);
+    assert(bi_eq(&result, &ldh));
+
+    /* lt */
+    result = bi_from_str("-999999999999999999999999999999");
+    assert(bi_lt(&d, &c) && !bi_lt(&c, &d) && !bi_lt(&c, &c));
+    assert(bi_lt(&result, &d) && bi_lt(&esf, &result) == 0);
+    assert(bi_lt(&cpd, &e) && bi_lt(&e, &cpd) == 0);
+    /* the most significant digits are equal, 5 * 2^64 + 1 and + 2 */
+    bigint_t lt_1 = bi_from_str("92233720368547758081");
+    bigint_t lt_2 = bi_from_str("92233720368547758082");
+    bigint_t mlt_1 = bi_from_str("-92233720368547758081");
+    bigint_t mlt_2 = bi_from_str("-92233720368547758082");
+    assert(bi_lt(&lt_1, &lt_2) && !bi_lt(&lt_2, &lt_1));
+    assert(bi_lt(&mlt_2, &mlt_1) && !bi_lt(&mlt_1, &mlt_2));
+
+    /* a single digit divisor carries the remainder through every digit */
+    bigint_t seven = bi_from_str("7");
+    bigint_t ud = bi_from_str("340282366920938463463374607431768211507");
+    bigint_t udq = bi_from_str("48611766702991209066196372490252601643");
+    bigint_t udr = bi_from_str("6");
+    result = bi_div(&ud, &seven);
+    assert(bi_eq(&result, &udq));
+    result = bi_mod(&ud, &seven);
+    assert(bi_eq(&result, &udr));
+    dynarr_char_t ud_str = bi_to_dec_str(&ud);
+    assert(strcmp(dynarr_char_to_str(&ud_str),
+                  "340282366920938463463374607431768211507")
+           == 0);
+
     /* very big */
     bigint_t very_big_1 = bi_from_tens_power(500);
     bigint_t very_big_2 = bi_from_str(
@@ -198,6 +321,113 @@ main()
     print_bi_dec(&result, '\n');
     assert(bi_eq(&result, &bery_big_1d2));
 
+    /* more than 255 digits */
+    bigint_t huge_1 = bi_from_tens_power(5000);
+    bigint_t huge_2 = bi_add(&huge_1, &very_big_2);
+    result = bi_mul(&huge_1, &huge_2);
+    printf("huge_1 * huge_2 size = %u\n", result.size);
+    bigint_t huge_q = bi_div(&result, &huge_2);
+    bigint_t huge_r = bi_mod(&result, &huge_2);
+    assert(bi_eq(&huge_q, &huge_1));
+    assert(huge_r.size == 0);
+    dynarr_char_t huge_str = bi_to_dec_str(&huge_2);
+    char* huge_cstr = dynarr_char_to_str(&huge_str);
+    bigint_t huge_2_parsed = bi_from_str(huge_cstr);
+    assert(bi_eq(&huge_2_parsed, &huge_2));
+
+    /* multiplication and division of each size range, the product is checked
+     * by division and the time of each operation is reported. the last two
+     * sizes are at and just above NTT_THRESHOLD */
+    int sizes[] = { 16, 64, 256, 1024, 4096, 16384, 16448 };
+    for (int k = 0; k < (int)(sizeof(sizes) / sizeof(sizes[0])); k++) {
+        int n = sizes[k], reps = 16384 / n + 1;
+        bigint_t x = random_bigint(n, n), y = random_bigint(n, n + 1);
+        clock_t start = clock();
+        for (int r = 0; r < reps; r++) {
+            bi_free(&result);
+            result = bi_mul(&x, &y);
+        }
+        double us = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / reps;
+        printf("bi_mul %5d x %5d digits: %12.1f us\n", n, n, us);
+        bigint_t q = ZERO_BIGINT, m;
+        start = clock();
+        for (int r = 0; r < reps; r++) {
+            bi_free(&q);
+            q = bi_div(&result, &y);
+        }
+        us = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC / reps;
+        printf("bi_div %5d / %5d digits: %12.1f us\n", 2 * n, n, us);
+        m = bi_mod(&result, &y);
+        assert(bi_eq(&q, &x) && m.size == 0);
+        bi_free(&m);
+        bi_free(&q);
+        if (n <= 4096) {
+            /* x * y + y - 1 has the largest remainder */
+            bigint_t y_1 = bi_sub(&y, &one);
+            bi_add_move(&result, &y_1);
+            q = bi_div(&result, &y);
+            m = bi_mod(&result, &y);
+            assert(bi_eq(&q, &x) && bi_eq(&m, &y_1));
+            bi_free(&q);
+            bi_free(&m);
+            bi_free(&y_1);
+            bi_free(&result);
+            result = bi_mul(&x, &x);
+            q = bi_div(&result, &x);
+            assert(bi_eq(&q, &x));
+            bi_free(&q);
+            /* gcd(x * y, x * x) is divided out of both exactly and leaves
+             * coprime cofactors */
+            bigint_t xy = bi_mul(&x, &y), gxy, p1, p2;
+            start = clock();
+            gxy = bi_gcd(&xy, &result);
+            us = (double)(clock() - start) * 1e6 / CLOCKS_PER_SEC;
+            printf("bi_gcd %5d , %5d digits: %12.1f us\n", 2 * n, 2 * n, us);
+            p1 = bi_divexact(&xy, &gxy);
+            p2 = bi_divexact(&result, &gxy);
+            q = bi_mul(&p1, &gxy);
+            assert(bi_eq(&q, &xy));
+            bi_free(&q);
+            q = bi_gcd(&p1, &p2);
+            assert(bi_eq(&q, &one));
+            bi_free(&q);
+            bi_free(&xy);
+            bi_free(&gxy);
+            bi_free(&p1);
+            bi_free(&p2);
+        }
+        bi_free(&x);
+        bi_free(&y);
+    }
+
+    /* the sign of a product with 1 or -1 */
+    bigint_t mone = bi_from_str("-1");
+    bigint_t mbig = bi_from_str("-12345678901234567890123");
+    bigint_t big = bi_from_str("12345678901234567890123");
+    bi_free(&result);
+    result = bi_mul(&mone, &mbig);
+    assert(bi_eq(&result, &big));
+    bi_free(&result);
+    result = bi_mul(&mbig, &mone);
+    assert(bi_eq(&result, &big));
+    bi_free(&result);
+    result = bi_mul(&one, &mbig);
+    assert(bi_eq(&result, &mbig));
+    bi_free(&result);
+    result = bi_mul(&mone, &big);
+    assert(bi_eq(&result, &mbig));
+
+    /* a quotient of several divisor lengths, the divisor is above the newton
+     * threshold that the makefile sets for this test */
+    bigint_t long_a = random_bigint(3000, 7), long_b = random_bigint(700, 8);
+    bigint_t long_q = bi_div(&long_a, &long_b);
+    bigint_t long_r = bi_mod(&long_a, &long_b);
+    assert(bi_lt(&long_r, &long_b));
+    bi_free(&result);
+    result = bi_mul(&long_q, &long_b);
+    bi_add_move(&result, &long_r);
+    assert(bi_eq(&result, &long_a));
+
     printf("all passed\n");
     return 0;
 }
\ No newline at end of file
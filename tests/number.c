@@ -3,6 +3,39 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/* a normalized number from the decimal strings of its numerator and
+ * denominator, made without any arithmetic of number.c */
+static number_t
+frac(const char* numer, const char* denom)
+{
+    return (number_t) {
+        .numer = bi_from_str(numer),
+        .denom = bi_from_str(denom),
+    };
+}
+
+/* check the result of an operation and free it */
+static void
+assert_number(number_t result, number_t expected)
+{
+    assert(number_eq(&result, &expected));
+    assert(result.denom.sign == 0);
+    number_free(&result);
+    number_free(&expected);
+}
+
+/* check a move variant that writes the result into a, then free b */
+static void
+assert_move(
+    void (*op)(number_t*, number_t*), number_t a, number_t b,
+    number_t expected
+)
+{
+    op(&a, &b);
+    assert_number(a, expected);
+    number_free(&b);
+}
+
 int
 main()
 {
@@ -61,6 +94,162 @@ main()
     number_print_frac(&result, '\n');
     assert(number_eq(&result, &two_power_two_hundred));
 
+    /* the sign is kept in the numerator when the numerator or the
+     * denominator is 1 */
+    number_t mbig = number_from_str("-61147327011081009466966");
+    number_t one = ONE_NUMBER, mone = number_from_i32(-1);
+    result = number_div(&one, &mbig);
+    assert(result.numer.sign == 1 && result.denom.sign == 0);
+    assert(number_lt(&result, &one));
+    number_free(&result);
+    result = number_div(&mbig, &mbig);
+    assert(number_eq(&result, &one));
+    number_free(&result);
+    result = number_div(&mbig, &one);
+    number_t mbig_neg = number_neg(&mbig);
+    number_t mresult = number_div(&mbig_neg, &mone);
+    assert(number_eq(&result, &mbig) && number_eq(&mresult, &mbig));
+    number_free(&result);
+    number_free(&mresult);
+    result = number_div(&mbig_neg, &mbig);
+    assert(number_eq(&result, &mone));
+    number_free(&result);
+    number_t mbig2 = number_from_str("-12345678901234567890123");
+    number_t big2 = number_neg(&mbig2);
+    result = number_mul(&mone, &mbig2);
+    assert(number_eq(&result, &big2));
+    number_free(&result);
+    result = number_mul(&mbig2, &mone);
+    assert(number_eq(&result, &big2));
+    number_free(&result);
+
+    /* equal numerators out of the int64 range, the larger denominator is
+     * closer to zero */
+    number_t nlt_3 = number_from_str("3"), nlt_5 = number_from_str("5");
+    number_t mbig_3 = number_div(&mbig, &nlt_3);
+    number_t mbig_5 = number_div(&mbig, &nlt_5);
+    number_t big_3 = number_neg(&mbig_3), big_5 = number_neg(&mbig_5);
+    assert(number_lt(&mbig_3, &mbig_5) && !number_lt(&mbig_5, &mbig_3));
+    assert(number_lt(&big_5, &big_3) && !number_lt(&big_3, &big_5));
+
+    /* the int64 fast paths around 2^62 and 2^63, a result that does not
+     * fit moves to the bigint path */
+    number_t p62 = frac("4611686018427387904", "1");
+    number_t mp62 = frac("-4611686018427387904", "1");
+    number_t p63m1 = frac("9223372036854775807", "1");
+    number_t mp63m1 = frac("-9223372036854775807", "1");
+    number_t p63 = frac("9223372036854775808", "1");
+    number_t two = frac("2", "1"), half = frac("1", "2");
+    number_t third = frac("1", "3"), mthird = frac("-1", "3");
+    number_t three = frac("3", "1"), mthree = frac("-3", "1");
+    number_t inv_p62 = frac("1", "4611686018427387904");
+    number_t p62_3 = frac("4611686018427387904", "3");
+    number_t p62_5 = frac("4611686018427387904", "5");
+    assert_number(number_add(&p62, &p62), frac("9223372036854775808", "1"));
+    assert_number(number_add(&p63m1, &one), frac("9223372036854775808", "1"));
+    assert_number(number_add(&mp63m1, &mone),
+                  frac("-9223372036854775808", "1"));
+    assert_number(number_add(&p63m1, &p62), frac("13835058055282163711", "1"));
+    assert_number(number_add(&mp63m1, &mp62),
+                  frac("-13835058055282163711", "1"));
+    assert_number(number_sub(&p62, &mp63m1),
+                  frac("13835058055282163711", "1"));
+    assert_number(number_add(&p63m1, &mp63m1), frac("0", "1"));
+    assert_number(number_add(&p63, &mone), frac("9223372036854775807", "1"));
+    assert_number(number_sub(&mp63m1, &one),
+                  frac("-9223372036854775808", "1"));
+    assert_number(number_sub(&mp62, &p62), frac("-9223372036854775808", "1"));
+    assert_number(number_sub(&p63, &p63m1), frac("1", "1"));
+    assert_number(number_mul(&p62, &two), frac("9223372036854775808", "1"));
+    assert_number(number_mul(&p62, &three),
+                  frac("13835058055282163712", "1"));
+    assert_number(number_mul(&mp62, &two), frac("-9223372036854775808", "1"));
+    assert_number(number_mul(&p62, &mp62),
+                  frac("-21267647932558653966460912964485513216", "1"));
+    assert_number(number_mul(&p62, &mthird),
+                  frac("-4611686018427387904", "3"));
+    assert_number(number_div(&p62, &half), frac("9223372036854775808", "1"));
+    assert_number(number_div(&mp62, &p62), frac("-1", "1"));
+    assert_number(number_div(&third, &mp62),
+                  frac("-1", "13835058055282163712"));
+    /* the common denominator of rationals overflows */
+    assert_number(number_add(&inv_p62, &inv_p62),
+                  frac("1", "2305843009213693952"));
+    assert_number(number_add(&inv_p62, &mthird),
+                  frac("-4611686018427387901", "13835058055282163712"));
+    assert_number(number_sub(&p62_3, &p62_5),
+                  frac("9223372036854775808", "15"));
+    assert_number(number_mul(&p62_3, &p62_5),
+                  frac("21267647932558653966460912964485513216", "15"));
+    number_t p62p1_3 = frac("4611686018427387905", "3");
+    number_t fifth = frac("1", "5"), two_sevenths = frac("2", "7");
+    assert_number(number_add(&p62p1_3, &fifth),
+                  frac("23058430092136939528", "15"));
+    assert_number(number_sub(&p62p1_3, &fifth),
+                  frac("23058430092136939522", "15"));
+    assert_number(number_mul(&p62p1_3, &two_sevenths),
+                  frac("9223372036854775810", "21"));
+    assert_number(number_add(&third, &mthird), frac("0", "1"));
+    /* floor modulo takes the sign of the divisor */
+    number_t seven = frac("7", "1"), mseven = frac("-7", "1");
+    assert_number(number_mod(&seven, &three), frac("1", "1"));
+    assert_number(number_mod(&mseven, &three), frac("2", "1"));
+    assert_number(number_mod(&seven, &mthree), frac("-2", "1"));
+    assert_number(number_mod(&mseven, &mthree), frac("-1", "1"));
+    assert_number(number_mod(&p63m1, &p62), frac("4611686018427387903", "1"));
+    assert_number(number_mod(&p62_3, &half), frac("1", "3"));
+    assert_number(number_mod(&mthird, &half), frac("1", "6"));
+    /* the cross products overflow */
+    assert(number_lt(&p63m1, &p63) && !number_lt(&p63, &p63m1));
+    assert(number_lt(&mp63m1, &mp62) && !number_lt(&mp62, &mp63m1));
+    assert(number_lt(&p62_5, &p62_3) && !number_lt(&p62_3, &p62_5));
+    assert(number_lt(&mthird, &inv_p62) && !number_lt(&inv_p62, &mthird));
+
+    /* the move variants, integers are updated in place */
+    assert_move(number_add_move, frac("5", "1"), frac("7", "1"),
+                frac("12", "1"));
+    assert_move(number_add_move, frac("18446744073709551615", "1"),
+                frac("1", "1"), frac("18446744073709551616", "1"));
+    assert_move(number_add_move, frac("-18446744073709551616", "1"),
+                frac("18446744073709551615", "1"), frac("-1", "1"));
+    assert_move(number_add_move, frac("-5", "1"), frac("5", "1"),
+                frac("0", "1"));
+    assert_move(number_sub_move, frac("3", "1"), frac("5", "1"),
+                frac("-2", "1"));
+    assert_move(number_sub_move, frac("18446744073709551616", "1"),
+                frac("-18446744073709551616", "1"),
+                frac("36893488147419103232", "1"));
+    assert_move(number_sub_move, frac("12345678901234567890123", "1"),
+                frac("12345678901234567890123", "1"), frac("0", "1"));
+    assert_move(number_add_move, frac("1", "3"), frac("1", "6"),
+                frac("1", "2"));
+    assert_move(number_add_move, frac("2", "1"), frac("-1", "3"),
+                frac("5", "3"));
+    assert_move(number_sub_move, frac("1", "3"), frac("1", "3"),
+                frac("0", "1"));
+    assert_move(number_sub_move, frac("-1", "4611686018427387904"),
+                frac("1", "3"),
+                frac("-4611686018427387907", "13835058055282163712"));
+    assert_move(number_mul_move, frac("-4611686018427387904", "1"),
+                frac("-4", "1"), frac("18446744073709551616", "1"));
+    assert_move(number_mul_move, frac("2", "3"), frac("-3", "4"),
+                frac("-1", "2"));
+    assert_move(number_mul_move, frac("-1", "1"),
+                frac("-12345678901234567890123", "1"),
+                frac("12345678901234567890123", "1"));
+    /* the same number on both sides */
+    number_t self = frac("18446744073709551615", "1");
+    number_add_move(&self, &self);
+    assert_number(self, frac("36893488147419103230", "1"));
+    self = frac("18446744073709551615", "1");
+    number_sub_move(&self, &self);
+    assert_number(self, frac("0", "1"));
+    /* the shared digits of a small integer are not written */
+    number_t shared_one = ONE_NUMBER;
+    number_add_move(&shared_one, &two);
+    assert_number(shared_one, frac("3", "1"));
+    assert_number(ONE_NUMBER, frac("1", "1"));
+
     number_t pi = number_from_str("3.1415926535");
     number_print_dec(&pi, 4, '\n');
     number_print_dec(&pi, 7, '\n');